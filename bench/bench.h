@@ -0,0 +1,77 @@
+#pragma once
+
+// Minimal benchmark helpers: each benchmark times one pass over a corpus of operations
+// The pass is repeated until it takes at least BENCH_MIN_NS, this is measured BENCH_REPEATS times.
+// Reported are the fastest and the median run in ns per operation and heap allocations per operation.
+// Include in exactly one translation unit per executable: it replaces the global operator new.
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+
+#ifndef BENCH_MIN_NS
+#define BENCH_MIN_NS 20000000  // 20 ms per measurement
+#endif
+
+#ifndef BENCH_REPEATS
+#define BENCH_REPEATS 7
+#endif
+
+
+static unsigned long bench_allocs = 0;  // heap allocations since start
+
+void *operator new( size_t size ) {
+    bench_allocs++;
+    void *ptr = malloc(size ? size : 1);
+    if( !ptr ) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete( void *ptr ) noexcept { free(ptr); }
+void operator delete( void *ptr, size_t ) noexcept { free(ptr); }
+
+
+// Keep the compiler from optimizing away a result
+template<typename T> static inline void bench_use( const T &value ) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+static const char *bench_filter = NULL;  // only run benchmarks with this substring in their name
+
+static void bench_header() {
+    printf("%-32s %10s %10s %10s\n", "benchmark", "min ns/op", "med ns/op", "allocs/op");
+}
+
+// Time pass(), which does ops operations, and print the results
+template<typename F> static void bench( const char *name, size_t ops, F pass ) {
+    typedef std::chrono::steady_clock clock;
+
+    if( bench_filter && !strstr(name, bench_filter) ) return;
+
+    unsigned long allocs = bench_allocs;
+    pass();  // warm up caches and count allocations of one pass
+    allocs = bench_allocs - allocs;
+
+    unsigned long passes = 1;
+    std::vector<double> results;
+    while( results.size() < BENCH_REPEATS ) {
+        auto start = clock::now();
+        for( unsigned long i = 0; i < passes; i++ ) pass();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        if( ns < BENCH_MIN_NS && results.empty() ) {
+            passes *= 2;  // calibrate
+            continue;
+        }
+        results.push_back(ns / passes / ops);
+    }
+
+    std::sort(results.begin(), results.end());
+    printf("%-32s %10.1f %10.1f %10.2f\n", name, results.front(), results[results.size() / 2], (double)allocs / ops);
+    fflush(stdout);
+}
@@ -0,0 +1,150 @@
+// Micro benchmarks of the RxV1600 command encoding and response decoding
+// Corpora: all command names, all known report values, config responses
+// of the emulator with power on and off and display text responses.
+// Usage: bench_codec [name filter]
+
+#include "bench.h"
+
+#include <rxv1600emu.h>
+
+#include <string>
+
+
+static uint32_t clock_ms = 0;
+static uint32_t virtual_millis() { return clock_ms; }
+
+
+static std::string hex( unsigned value ) {
+    char buf[3];
+    snprintf(buf, sizeof(buf), "%02X", value);
+    return buf;
+}
+
+
+// Copies of the command names, so lookups do not compare table pointers
+static std::vector<std::string> command_names() {
+    std::vector<std::string> names;
+    for( auto it = RxV1600::begin(); it != RxV1600::end(); it++ ) {
+        names.push_back(it->first);
+    }
+    names.push_back("NoSuchCommand");  // a miss, as from a typo in a payload
+    return names;
+}
+
+
+// Report frames for every id and value the tables know
+static std::vector<std::string> report_frames() {
+    std::vector<std::string> frames;
+    for( unsigned id = 0; id <= 0xFF; id++ ) {
+        if( !RxV1600::report_name(id) ) continue;
+        for( unsigned value = 0; value <= 0xFF; value++ ) {
+            if( RxV1600::value_string(id, value) ) {
+                frames.push_back("\x02" "00" + hex(id) + hex(value) + "\x03");
+            }
+        }
+    }
+    return frames;
+}
+
+
+// Config response of the emulator
+static std::string config_frame( bool on ) {
+    RxV1600Emu emu(virtual_millis);
+    if( !on ) emu.set(0x20, 0);
+
+    for( const char *ch = RxV1600::command("Ready"); *ch; ch++ ) {
+        emu.write(*ch);
+    }
+    clock_ms += 1000;
+
+    std::string frame;
+    while( emu.available() ) {
+        frame += (char)emu.read();
+    }
+    return frame;
+}
+
+
+// Display text frames of all text ids
+static std::vector<std::string> text_frames() {
+    static const char *texts[] = { "-80.0 dB", "  0.0 dB", "Cbl/Sat ", "  Vienna", "RX-V1600" };
+    std::vector<std::string> frames;
+    for( unsigned id = 0; id <= 0xFF; id++ ) {
+        if( !RxV1600::display_name(id) ) continue;
+        for( const char *text : texts ) {
+            frames.push_back("\x11" + hex(id) + text + "\x03");
+        }
+    }
+    return frames;
+}
+
+
+int main( int argc, char *argv[] ) {
+    if( argc > 1 ) bench_filter = argv[1];
+
+    std::vector<std::string> names = command_names();
+    std::vector<std::string> reports = report_frames();
+    std::vector<std::string> texts = text_frames();
+    std::string config_on = config_frame(true);
+    std::string config_off = config_frame(false);
+
+    RxV1600 rxv;
+    bool power;
+    if( !rxv.decodeConfig(config_on.c_str(), power) || !power || !rxv.decodeConfig(config_off.c_str(), power) || power ) {
+        fprintf(stderr, "invalid config corpus\n");
+        return 1;
+    }
+
+    printf("corpora: %zu commands, %zu reports, %zu texts, config %zu/%zu chars\n",
+        names.size(), reports.size(), texts.size(), config_on.size(), config_off.size());
+    bench_header();
+
+    bench("command", names.size(), [&]() {
+        for( const std::string &name : names ) bench_use(RxV1600::command(name.c_str()));
+    });
+
+    bench("command_value", 3 * 256, [&]() {
+        for( const char *name : { "MainVolumeSet", "Zone2VolumeSet", "Zone3VolumeSet" } ) {
+            for( unsigned value = 0; value <= 0xFF; value++ ) bench_use(RxV1600::command_value(name, value));
+        }
+    });
+
+    bench("decode", reports.size(), [&]() {
+        uint8_t id;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+        for( const std::string &frame : reports ) bench_use(rxv.decode(frame.c_str(), id, guard, origin));
+    });
+
+    bench("decode+report_value_string", reports.size(), [&]() {
+        uint8_t id;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+        for( const std::string &frame : reports ) {
+            rxv.decode(frame.c_str(), id, guard, origin);
+            bench_use(rxv.report_value_string(id));
+        }
+    });
+
+    bench("decodeText", texts.size(), [&]() {
+        uint8_t id;
+        char text[9];
+        for( const std::string &frame : texts ) bench_use(rxv.decodeText(frame.c_str(), id, text));
+    });
+
+    bench("decodeConfig on", 1, [&]() {
+        bench_use(rxv.decodeConfig(config_on.c_str(), power));
+    });
+
+    bench("decodeConfig off", 1, [&]() {
+        bench_use(rxv.decodeConfig(config_off.c_str(), power));
+    });
+
+    bench("decodeConfig on changed", 2, [&]() {
+        uint8_t changed[32];
+        bench_use(rxv.decodeConfig(config_off.c_str(), power, changed));
+        bench_use(rxv.decodeConfig(config_on.c_str(), power, changed));
+    });
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+// End to end benchmark of RxV1600Comm and RxV1600Volume against the emulated receiver
+// Synthetic workloads offer requests like the gateways get them from MQTT, the emulator
+// answers with 9600 baud timing. Time is virtual, so results are repeatable and
+// independent of the machine: latencies are from request to the report (or config)
+// that confirms it, throughput counts commands on the wire per second.
+// Usage: bench_e2e [-d seconds] [-s seed] [-v] [name filter]
+
+#include <rxv1600emu.h>
+#include <rxv1600volume.h>
+
+#include <algorithm>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+
+static uint32_t clock_ms = 0;
+static uint32_t virtual_millis() { return clock_ms; }
+
+
+// Request rates of a workload, 0 disables a request type
+typedef struct workload {
+    const char *name;
+    uint32_t volume_ms;  // a new main volume slider position
+    uint32_t burst_ms;   // slider moves only this long every 5 s, 0 for always
+    uint32_t input_ms;   // an input change, alternating two inputs
+    uint32_t ready_ms;   // a Ready to resync the cached state
+    unsigned loss_pct;   // dropped response frames
+} workload_t;
+
+static const workload_t WORKLOADS[] = {
+    { "volume storm",      10,    0,    0,    0,  0 },
+    { "input flips",        0,    0,  100,    0,  0 },
+    { "ready resyncs",      0,    0,    0, 1000,  0 },
+    { "mixed",             20, 2000,  700, 5000,  0 },
+    { "mixed loss 5%",     20, 2000,  700, 5000,  5 },
+    { "mixed loss 20%",    20, 2000,  700, 5000, 20 },
+};
+
+
+// Latencies of one request type
+class Latencies {
+    public:
+
+    Latencies( const char *name ) : name(name), rejected(0), lost(0) {}
+
+    void print( bool histogram ) {
+        size_t n = ms.size();
+        if( !n && !rejected && !lost ) return;
+
+        std::sort(ms.begin(), ms.end());
+        printf("  %-7s %7zu done %6u rejected %5u lost", name, n, rejected, lost);
+        if( n ) {
+            printf("  p50 %5u  p90 %5u  p99 %5u  max %5u ms", ms[n / 2], ms[n * 9 / 10], ms[n * 99 / 100], ms[n - 1]);
+        }
+        printf("\n");
+
+        if( !histogram || !n ) return;
+        unsigned buckets[32] = { 0 };  // log2 of latency
+        for( uint32_t value : ms ) {
+            unsigned b = 0;
+            while( value >>= 1 ) b++;
+            buckets[b]++;
+        }
+        for( unsigned b = 0; b < 32; b++ ) {
+            if( !buckets[b] ) continue;
+            unsigned bar = (unsigned)((buckets[b] * 50 + n - 1) / n);
+            printf("    %5u - %5u ms %7u %.*s\n", 1u << b, (2u << b) - 1, buckets[b], bar,
+                "##################################################");
+        }
+    }
+
+    const char *name;
+    std::vector<uint32_t> ms;  // latencies of confirmed requests
+    unsigned rejected;         // requests RxV1600Comm did not accept
+    unsigned lost;             // accepted requests that timed out
+};
+
+
+// Receiver, communication and workload state of one run
+class Run {
+    public:
+
+    Run( const workload_t &w, uint32_t seed ) :
+        w(w), emu(virtual_millis), comm(emu, virtual_millis), volume(comm, rxv),
+        volumes("volume"), inputs("input"), readies("ready"),
+        inflight(NULL), inflight_ms(0), vol(0x60), vol_step(3), flip(false) {
+        emu.errors(w.loss_pct, 0, seed);
+        comm.on_recv(recvd, this);
+    }
+
+    void run( uint32_t duration_ms ) {
+        comm.send(RxV1600::command("Ready"));  // like the gateways after boot
+        uint32_t start = clock_ms;
+        uint32_t end = start + duration_ms;
+        while( clock_ms != end ) {
+            uint32_t t = clock_ms - start;
+            bool sliding = !w.burst_ms || t % 5000 < w.burst_ms;
+            if( w.volume_ms && t % w.volume_ms == 0 && sliding ) request_volume();
+            if( w.input_ms && t % w.input_ms == 0 ) request(inputs, (flip = !flip) ? "Input_Tuner" : "Input_Dvd");
+            if( w.ready_ms && t % w.ready_ms == 0 && t ) request(readies, "Ready");
+
+            clock_ms++;
+            comm.handle();
+            volume.handle();
+        }
+        elapsed_ms = duration_ms;
+    }
+
+    void print( bool histogram ) {
+        double secs = elapsed_ms / 1000.0;
+        printf("%s: %.1f commands/s on the wire, %.1f responses/s, link %s\n",
+            w.name, emu.commands() / secs, emu.responses() / secs, RxV1600Comm::link_name(comm.link()));
+        volumes.print(histogram);
+        inputs.print(histogram);
+        readies.print(histogram);
+    }
+
+    private:
+
+    // slider sweeping between -48 dB and 0 dB
+    void request_volume() {
+        if( vol + vol_step > 0xC7 || vol + vol_step < 0x60 ) vol_step = -vol_step;
+        vol += vol_step;
+        volume.command_value("MainVolumeSet", vol);
+        pending_volumes.push_back({ clock_ms, (uint8_t)vol });
+    }
+
+    void request( Latencies &lat, const char *name ) {
+        if( comm.send(RxV1600::command(name)) ) {
+            inflight = &lat;
+            inflight_ms = clock_ms;
+        }
+        else {
+            lat.rejected++;
+        }
+    }
+
+    // a volume request is confirmed by the report of its value or of a newer request
+    void volume_report( uint8_t value ) {
+        for( size_t i = pending_volumes.size(); i-- > 0; ) {
+            if( pending_volumes[i].value != value ) continue;
+            for( size_t j = 0; j <= i; j++ ) {
+                volumes.ms.push_back(clock_ms - pending_volumes.front().at);
+                pending_volumes.pop_front();
+            }
+            return;
+        }
+    }
+
+    static void recvd( const char *resp, void *ctx ) {
+        Run &r = *(Run *)ctx;
+        bool power;
+        uint8_t id;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+
+        if( !resp ) {
+            if( r.inflight ) r.inflight->lost++;
+            r.inflight = NULL;
+        }
+        else if( r.rxv.decodeConfig(resp, power) ) {
+            if( r.inflight == &r.readies ) r.readies.ms.push_back(clock_ms - r.inflight_ms);
+            if( r.inflight == &r.readies ) r.inflight = NULL;
+        }
+        else if( r.rxv.decode(resp, id, guard, origin) ) {
+            if( id == 0x26 ) r.volume_report(r.rxv.report_value(id));
+            if( id == 0x21 && r.inflight == &r.inputs ) {
+                r.inputs.ms.push_back(clock_ms - r.inflight_ms);
+                r.inflight = NULL;
+            }
+        }
+    }
+
+    typedef struct volume_request {
+        uint32_t at;
+        uint8_t value;
+    } volume_request_t;
+
+    const workload_t &w;
+    RxV1600Emu emu;
+    RxV1600Comm comm;
+    RxV1600 rxv;
+    RxV1600Volume volume;
+    Latencies volumes;
+    Latencies inputs;
+    Latencies readies;
+    std::deque<volume_request_t> pending_volumes;  // requested, not yet confirmed
+    Latencies *inflight;   // request type of the command RxV1600Comm is sending
+    uint32_t inflight_ms;  // when it was requested
+    int vol;
+    int vol_step;
+    bool flip;
+    uint32_t elapsed_ms;
+};
+
+
+int main( int argc, char *argv[] ) {
+    uint32_t duration_ms = 60000;
+    uint32_t seed = 1;
+    bool histogram = false;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "d:s:v")) != -1 ) {
+        switch( opt ) {
+            case 'd': duration_ms = strtoul(optarg, NULL, 0) * 1000; break;
+            case 's': seed = strtoul(optarg, NULL, 0); break;
+            case 'v': histogram = true; break;
+            default:
+                fprintf(stderr, "Usage: %s [-d seconds] [-s seed] [-v] [name filter]\n", argv[0]);
+                return 1;
+        }
+    }
+    const char *filter = optind < argc ? argv[optind] : NULL;
+
+    for( const workload_t &w : WORKLOADS ) {
+        if( filter && !strstr(w.name, filter) ) continue;
+        Run *r = new Run(w, seed);
+        r->run(duration_ms);
+        r->print(histogram);
+        delete r;
+    }
+
+    return 0;
+}
@@ -23,10 +23,6 @@
 #include <time.h>
 
 
-// Reset reason
-#include "rom/rtc.h"
-
-
 // Web status page and OTA updater
 #define WEBSERVER_PORT 80
 
@@ -52,10 +48,92 @@ char start_time[30];
 
 
 #include <rxv1600.h>
+#include <rxv1600batch.h>
+#include <rxv1600volume.h>
+#include <rxv1600scene.h>
+#include <rxv1600coalescer.h>
+#include <rxv1600metrics.h>
+#include <rxv1600profiler.h>
+#include <rxv1600log.h>
+#include <rxv1600logqueue.h>
+#include <rxv1600web.h>
+
+#ifndef RECONCILE_MS
+#define RECONCILE_MS (5 * 60 * 1000)  // resync cached state with a Ready dump while idle
+#endif
+
+#ifndef CAPTURE_SIZE
+#define CAPTURE_SIZE (16 * 1024)  // bytes of serial traffic kept for download at /capture
+#endif
+
+#ifndef COALESCE_MS
+#define COALESCE_MS 200  // publish changes of a status topic at most once per window
+#endif
+
+#ifndef STATE_JSON
+#define STATE_JSON 1  // also publish config dumps as one JSON message to MQTT_TOPIC "/state"
+#endif
+
+#ifndef STATE_JSON_SIZE
+#define STATE_JSON_SIZE 2048  // max length of the /state message
+#endif
 
 RxV1600Comm rxvcomm(Serial1);
 RxV1600 rxv;
-auto help = RxV1600::end();
+
+// Gateway health for /metrics, comm metrics come from rxvcomm
+RxV1600Web::health_t health = {};
+
+#ifdef RXV1600_PROFILE
+#ifndef PROFILE_PUBLISH_MS
+#define PROFILE_PUBLISH_MS (60 * 1000)  // publish and restart handler profiles
+#endif
+
+// Durations of the handlers called by loop(), at /profile and MQTT_TOPIC "/status/Profile/<name>"
+enum { P_COMM, P_VOLUME, P_SCENES, P_BATCH, P_STATUS, P_MQTT, P_PIN, P_WIFI, P_REBOOT };
+const char *const profile_names[] = { "comm", "volume", "scenes", "batch", "status", "mqtt", "pin", "wifi", "reboot" };
+RxV1600Profiler profiler(profile_names, sizeof(profile_names) / sizeof(*profile_names));
+#endif
+
+uint8_t capture_buf[CAPTURE_SIZE];
+RxV1600Capture capture(capture_buf, sizeof(capture_buf));  // replay downloads with rxv1600replay
+RxV1600Volume volume(rxvcomm, rxv);  // coalesces volume steps into one absolute volume set
+
+// Retained status topics, published on change only
+void publish_status(uint8_t id, void *ctx);
+RxV1600Coalescer status(rxv, COALESCE_MS, publish_status);
+
+
+// Scenes, triggered by mqtt payload "scene,<name>", web page /scene or the bluetooth pin
+const RxV1600Scene::step_t SCENE_BT[] = {
+    RXV_CMD("MainZonePower_On"), RXV_READY(0, 8000), RXV_CMD("Input_Cbl-Sat"), RXV_END };
+const RxV1600Scene::step_t SCENE_TV[] = {
+    RXV_CMD("Input_Dtv"), RXV_END };
+const RxV1600Scene::step_t SCENE_TV_OFF[] = {
+    RXV_CMD("Input_Dtv"), RXV_CMD("MainZonePower_Off"), RXV_END };
+// "Speaker A Relay" only switches front left and right, so also switch center and back by DSP
+const RxV1600Scene::step_t SCENE_A_ON[] = {
+    RXV_CMD("SpeakerRelayA_On"), RXV_WAIT(0x2E, RXV_BIT(1), 2000), RXV_CMD("DSP_Adventure"), RXV_END };
+const RxV1600Scene::step_t SCENE_A_OFF[] = {
+    RXV_CMD("SpeakerRelayA_Off"), RXV_WAIT(0x2E, RXV_BIT(0), 2000), RXV_CMD("DSP_2chStereo"), RXV_END };
+
+const RxV1600Scene::scene_t SCENES[] = {
+    { "bt",     SCENE_BT },
+    { "tv",     SCENE_TV },
+    { "tv-off", SCENE_TV_OFF },
+    { "a-on",   SCENE_A_ON },
+    { "a-off",  SCENE_A_OFF }
+};
+
+RxV1600Scene scenes(rxvcomm, rxv, SCENES, sizeof(SCENES) / sizeof(*SCENES));
+RxV1600Batch batch(rxvcomm);  // commands of mqtt payloads, queued per message
+
+
+// true while a scene switches speaker A together with the DSP mode
+bool speaker_scene() {
+    const char *name = scenes.running();
+    return name && (strcmp(name, "a-on") == 0 || strcmp(name, "a-off") == 0);
+}
 
 
 // define constant IsoDate as nicer variant of __DATE__ (from https://stackoverflow.com/a/64718070)
@@ -78,28 +156,111 @@ constexpr char IsoDate[] = {
 };
 
 
+#ifndef LOG_CELLS
+#define LOG_CELLS 64  // log lines waiting for log_task(), power of 2
+#endif
+
+#ifndef LOG_INFO_MAX
+#define LOG_INFO_MAX 100  // info and debug lines per second, more are dropped
+#endif
+
+// Log lines are queued, so logging never blocks loop() or web server callbacks
+RxV1600LogQueue::cell_t log_cells[LOG_CELLS];
+RxV1600LogQueue log_queue(log_cells, LOG_CELLS);
+
+
 void slog(const char *message, uint16_t pri = LOG_INFO) {
-    static bool log_infos = true;
-    
-    if (pri < LOG_INFO || log_infos) {
-        Serial.println(message);
-        syslog.log(pri, message);
-    }
+    log_queue.push(pri, message);
+}
+
+
+// Low priority task writing queued log lines to Serial and syslog
+void log_task(void *param) {
+    char line[RxV1600LogQueue::TEXT_MAX];
+    unsigned pri;
+    uint32_t reported = 0;
+
+    for (;;) {
+        while (log_queue.pop(pri, line, sizeof(line))) {
+            Serial.println(line);
+            syslog.log(pri, line);
+        }
 
-    if (log_infos && millis() > 10 * 60 * 1000) {
-        log_infos = false;  // log infos only for first 10 minutes
-        slog("Switch off info level messages", LOG_NOTICE);
+        uint32_t dropped = log_queue.dropped();
+        if (dropped != reported) {
+            snprintf(line, sizeof(line), "Dropped %u log lines", (unsigned)(dropped - reported));
+            Serial.println(line);
+            syslog.log(LOG_WARNING, line);
+            reported = dropped;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
 
 
-void publish( const char *topic, const char *payload ) {
-    if (mqtt.connected() && !mqtt.publish(topic, payload)) {
+void publish( const char *topic, const char *payload, bool retained = false ) {
+    if (mqtt.connected() && !mqtt.publish(topic, payload, retained)) {
+        health.mqtt_publish_failures++;
         slog("Mqtt publish failed");
     }
 }
 
 
+#if STATE_JSON
+// Publish all known report values as one retained message, streamed since it exceeds the mqtt buffer
+void publish_state() {
+    static char json[STATE_JSON_SIZE];
+
+    size_t len = rxv.state_json(json, sizeof(json));
+    if (len >= sizeof(json)) {
+        slog("State exceeds STATE_JSON_SIZE", LOG_WARNING);
+        return;
+    }
+    if (mqtt.connected()) {
+        if (!mqtt.beginPublish(MQTT_TOPIC "/state", len, true)
+                || mqtt.write((const uint8_t *)json, len) != len
+                || !mqtt.endPublish()) {
+            health.mqtt_publish_failures++;
+            slog("Mqtt publish failed");
+        }
+    }
+}
+#endif
+
+
+// Publish the current value of a report to its retained status topic
+void publish_status(uint8_t id, void *ctx) {
+    const char *name = rxv.report_name(id);
+    const char *value = rxv.report_value_string(id);
+    char topic[80];
+    char buf[10];
+
+    if (!name) return;
+    if (!value) {
+        snprintf(buf, sizeof(buf), "raw %u", rxv.report_value(id));
+        value = buf;
+    }
+    snprintf(topic, sizeof(topic), MQTT_TOPIC "/status/%s", name);
+    publish(topic, value, true);
+}
+
+
+// Publish the command catalog as one retained message, streamed since it exceeds the mqtt buffer
+void publish_catalog() {
+    size_t len = RxV1600::catalog_length();
+
+    if (mqtt.connected()) {
+        if (!mqtt.beginPublish(MQTT_TOPIC "/commands", len, true)
+                || mqtt.write((const uint8_t *)RxV1600::catalog(), len) != len
+                || !mqtt.endPublish()) {
+            health.mqtt_publish_failures++;
+            slog("Mqtt publish failed");
+        }
+    }
+}
+
+
 // check and report RSSI and BSSID changes
 bool handle_wifi() {
     static const uint32_t reconnectInterval = 10000;  // try reconnect every 10s
@@ -116,6 +277,7 @@ bool handle_wifi() {
         uint32_t now = millis();
         if (reconnectCount == 0 || now - reconnectPrev > reconnectInterval) {
             WiFi.reconnect();
+            health.wifi_reconnects++;
             reconnectCount++;
             if (reconnectCount > reconnectLimit) {
                 Serial.println("Failed to reconnect WLAN, about to reset");
@@ -144,7 +306,6 @@ const char* afterLastSpace(const char* s) {
 
 
 char web_msg[80] = "";  // main web page displays and then clears this
-int first_vol = 0;  // double vol up or down web commands: first changes 0.5dB, following change 1dB
 
 // Standard web page
 const char *main_page() {
@@ -338,13 +499,13 @@ void setup_webserver() {
 
     // Speaker A on
     web_server.on("/a-on", HTTP_POST, [](AsyncWebServerRequest *request) { 
-        publish(MQTT_TOPIC "/cmd", "SpeakerRelayA_On");
+        publish(MQTT_TOPIC "/cmd", "scene,a-on");
         request->send(200); 
     });
 
     // Speaker A off
     web_server.on("/a-off", HTTP_POST, [](AsyncWebServerRequest *request) { 
-        publish(MQTT_TOPIC "/cmd", "SpeakerRelayA_Off");
+        publish(MQTT_TOPIC "/cmd", "scene,a-off");
         request->send(200); 
     });
 
@@ -401,14 +562,12 @@ void setup_webserver() {
 
     // Volume up
     web_server.on("/vol-up", HTTP_POST, [](AsyncWebServerRequest *request) { 
-        first_vol = 1;
         publish(MQTT_TOPIC "/cmd", "MainVolume_Up");
         request->send(200); 
     });
 
     // Volume down
     web_server.on("/vol-down", HTTP_POST, [](AsyncWebServerRequest *request) { 
-        first_vol = -1;
         publish(MQTT_TOPIC "/cmd", "MainVolume_Down");
         request->send(200); 
     });
@@ -425,6 +584,42 @@ void setup_webserver() {
         request->send(200); 
     });
 
+    // Fade volume to dB value "v" within "s" seconds using optional "curve" (linear, in, out, smooth)
+    web_server.on("/fade", HTTP_POST, [](AsyncWebServerRequest *request) { 
+        String vol = request->arg("v");
+        String secs = request->arg("s");
+        if (!vol.isEmpty() && !secs.isEmpty()) {
+            String curve = request->arg("curve");
+            char cmd[60];
+            snprintf(cmd, sizeof(cmd), "MainVolumeRamp,%d,%s,%s", constrain(atoi(vol.c_str()) * 2 + 199, 0, 0xff), 
+                secs.c_str(), curve.isEmpty() ? "linear" : curve.c_str());
+            publish(MQTT_TOPIC "/cmd", cmd);
+        }
+        request->send(200); 
+    });
+
+    // Start scene "name"
+    web_server.on("/scene", HTTP_POST, [](AsyncWebServerRequest *request) { 
+        String name = request->arg("name");
+        if (!name.isEmpty()) {
+            char cmd[60];
+            snprintf(cmd, sizeof(cmd), "scene,%s", name.c_str());
+            publish(MQTT_TOPIC "/cmd", cmd);
+        }
+        request->send(200); 
+    });
+
+    // Sleep: fade volume out within "m" minutes, then power off main zone
+    web_server.on("/sleep", HTTP_POST, [](AsyncWebServerRequest *request) { 
+        String mins = request->arg("m");
+        if (!mins.isEmpty()) {
+            char cmd[60];
+            snprintf(cmd, sizeof(cmd), "MainVolumeRamp,0,%d,in,MainZonePower_Off", atoi(mins.c_str()) * 60);
+            publish(MQTT_TOPIC "/cmd", cmd);
+        }
+        request->send(200); 
+    });
+
     // TV input
     web_server.on("/tv", HTTP_POST, [](AsyncWebServerRequest *request) { 
         publish(MQTT_TOPIC "/cmd", "Input_Dtv");
@@ -516,6 +711,15 @@ void setup_webserver() {
         }
     });
 
+    // Command catalog, metrics, profile and capture download
+    static const char etag[] = "\"" VERSION " " __DATE__ " " __TIME__ "\"";
+    RxV1600Web::commands(web_server, etag);
+    RxV1600Web::metrics(web_server, rxvcomm, health);
+#ifdef RXV1600_PROFILE
+    RxV1600Web::profile(web_server, profiler);
+#endif
+    RxV1600Web::capture(web_server, capture);
+
     // Catch all page
     web_server.onNotFound( [](AsyncWebServerRequest *request) { 
         snprintf(web_msg, sizeof(web_msg), "%s", "<h2>page not found</h2>\n");
@@ -554,84 +758,100 @@ bool check_ntptime() {
 // Reset reason can be quite useful...
 // Messages from arduino core example
 void print_reset_reason(int core) {
-  switch (rtc_get_reset_reason(core)) {
-    case 1  : slog("Vbat power on reset");break;
-    case 3  : slog("Software reset digital core");break;
-    case 4  : slog("Legacy watch dog reset digital core");break;
-    case 5  : slog("Deep Sleep reset digital core");break;
-    case 6  : slog("Reset by SLC module, reset digital core");break;
-    case 7  : slog("Timer Group0 Watch dog reset digital core");break;
-    case 8  : slog("Timer Group1 Watch dog reset digital core");break;
-    case 9  : slog("RTC Watch dog Reset digital core");break;
-    case 10 : slog("Instrusion tested to reset CPU");break;
-    case 11 : slog("Time Group reset CPU");break;
-    case 12 : slog("Software reset CPU");break;
-    case 13 : slog("RTC Watch dog Reset CPU");break;
-    case 14 : slog("for APP CPU, reseted by PRO CPU");break;
-    case 15 : slog("Reset when the vdd voltage is not stable");break;
-    case 16 : slog("RTC Watch dog reset digital core and rtc module");break;
-    default : slog("Reset reason unknown");
-  }
+    slog(RxV1600Web::reset_reason(core));
 }
 
 
-// Called on incoming mqtt messages
-void mqtt_callback(char* topic, byte* payload, unsigned int length) {
-    if (strcasecmp(MQTT_TOPIC "/cmd", topic) == 0) {
-        snprintf(msg, sizeof(msg), "%.*s", length, (char *)payload);
+// Start a volume ramp from remaining payload fields "value,seconds[,curve[,command]]"
+bool ramp_command( RxV1600Volume::zone_t zone, RxV1600Batch::span_t rest ) {
+    RxV1600Batch::span_t field;
+    char value[8], seconds[16], curve[16], then[RxV1600Batch::NAME_MAX];
+    bool has_curve, has_then;
 
-        char *cmd_name = std::strtok(msg, ",");
-        char *cmd_value = std::strtok(NULL, ",");
-        bool cmd_excess = (std::strtok(NULL, ",") != NULL);
-        const char *cmd = NULL;
+    if( !RxV1600Batch::split(rest, field) || !RxV1600Batch::copy(field, value, sizeof(value)) ) return false;
+    if( !RxV1600Batch::split(rest, field) || !RxV1600Batch::copy(field, seconds, sizeof(seconds)) ) return false;
+    if( (has_curve = RxV1600Batch::split(rest, field)) && !RxV1600Batch::copy(field, curve, sizeof(curve)) ) return false;
+    if( (has_then = RxV1600Batch::split(rest, field)) && !RxV1600Batch::copy(field, then, sizeof(then)) ) return false;
+    if( rest.str || !*value || !*seconds ) return false;
 
-        if( cmd_value ) {
-            if( cmd_excess ) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': excess argument", length, (char *)payload);
-                slog(msg);
-                return;
-            }
-            size_t value_len = strlen(cmd_value);
-            char *endp;
-            unsigned long value = strtoul(cmd_value, &endp, 0);
-            if( endp != &cmd_value[value_len] ) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': excess value", length, (char *)payload);
-                slog(msg);
-                return;
-            }
-            else if( value > 0xff ) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': value overflow", length, (char *)payload);
-                slog(msg);
-                return;
-            }
-            else {
-                cmd = rxv.command_value(cmd_name, value);
-            }
+    char *endp;
+    unsigned long raw = strtoul(value, &endp, 0);
+    if( *endp || raw > 0xff ) return false;
+    double secs = strtod(seconds, &endp);
+    if( *endp || secs < 0 || secs > 24 * 3600 ) return false;
+
+    return volume.ramp(zone, raw, secs * 1000, has_curve ? RxV1600Volume::ramp_curve(curve) : RxV1600Volume::C_LINEAR, has_then ? then : NULL);
+}
+
+
+// Handle a payload with one gateway command: volume ramp or target, scene, help or reset
+// Returns false if the payload is for the command batch queue
+bool gateway_command( const char *payload, unsigned int length ) {
+    RxV1600Batch::cursor_t cur;
+    RxV1600Batch::span_t item, rest, field;
+    char name[RxV1600Batch::NAME_MAX];
+
+    RxV1600Batch::begin(cur, payload, length);
+    if( !RxV1600Batch::next(cur, item) || RxV1600Batch::next(cur, rest) || cur.error ) return false;
+
+    rest = item;
+    RxV1600Batch::split(rest, field);
+    if( !RxV1600Batch::copy(field, name, sizeof(name)) ) return false;
+
+    RxV1600Volume::zone_t zone;
+    if( RxV1600Volume::ramp_zone(name, zone) ) {
+        if( !ramp_command(zone, rest) ) {
+            snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': invalid ramp", length, payload);
+            slog(msg);
         }
-        else {
-            cmd = rxv.command(msg);
+        return true;
+    }
+
+    if( strcasecmp("scene", name) == 0 ) {
+        char scene[16];
+        if( !RxV1600Batch::split(rest, field) || !RxV1600Batch::copy(field, scene, sizeof(scene)) || !scenes.start(scene) ) {
+            snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': unknown scene", length, payload);
+            slog(msg);
         }
+        return true;
+    }
 
-        if( cmd ) {
-            if( !rxvcomm.send(cmd) ) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt command '%s'", cmd);
-                slog(msg);
-            }
+    if( !rest.str ) {
+        if( strcasecmp("help", name) == 0 ) {
+            publish_catalog();
+            return true;
+        }
+        if( strcasecmp("reset", name) == 0 ) {
+            slog("RESET");
+            delay(100);
+            Serial1.end();
+            ESP.restart();
+        }
+        return volume.command(name);  // sent later as newest volume target
+    }
+
+    char value[8];
+    char *endp;
+    if( !RxV1600Batch::split(rest, field) || rest.str || !RxV1600Batch::copy(field, value, sizeof(value)) ) return false;
+    unsigned long number = strtoul(value, &endp, 0);
+    return *value && !*endp && number <= 0xff && volume.command_value(name, number);  // sent later as newest volume target
+}
+
+
+// Called on incoming mqtt messages
+// Payload is one command "Name[,value]" or a batch: lines separated by newline or ';', or a JSON array of them
+void mqtt_callback(char* topic, byte* payload, unsigned int length) {
+    if (strcasecmp(MQTT_TOPIC "/cmd", topic) == 0) {
+        if( gateway_command((const char *)payload, length) ) return;
+
+        unsigned failed;
+        RxV1600Batch::error_t error = batch.submit((const char *)payload, length, &failed);
+        if( error ) {
+            snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': %s at command %u", length, (char *)payload, RxV1600Batch::error_name(error), failed + 1);
+            slog(msg, LOG_WARNING);
         }
         else {
-            if( strcasecmp("help", msg) == 0 ) {
-                help = RxV1600::begin();
-            }
-            else if( strcasecmp("reset", msg) == 0 ) {
-                slog("RESET");
-                delay(100);
-                Serial1.end();
-                ESP.restart();
-            }
-            else {
-                snprintf(msg, sizeof(msg), "Ignore unknown mqtt payload '%.*s'", length, (char *)payload);
-                slog(msg, LOG_WARNING);
-            }
+            volume.cancel();  // user command stops fading
         }
     }
     else {
@@ -662,6 +882,9 @@ bool handle_mqtt( bool time_valid ) {
             && mqtt.subscribe(MQTT_TOPIC "/cmd")) {
             snprintf(msg, sizeof(msg), "Connected to MQTT broker %s:%d using topic %s", MQTT_SERVER, MQTT_PORT, MQTT_TOPIC);
             slog(msg, LOG_NOTICE);
+            health.mqtt_connects++;
+            status.republish();  // in case the broker lost retained values
+            publish_catalog();
             return true;
         }
 
@@ -686,6 +909,15 @@ void handle_reboot() {
 }
 
 
+#if RXV1600_LOG_LEVEL > RXV1600_LOG_NONE
+// Library log lines to the log queue with matching syslog priority
+void log_line(RxV1600Log::level_t level, const char *line, void *ctx) {
+    static const uint16_t pri[] = { LOG_ERR, LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG };
+    log_queue.push(pri[level], line);
+}
+#endif
+
+
 void recvd( const char *resp, void *ctx ) {
     bool power;
     uint8_t id;
@@ -697,19 +929,24 @@ void recvd( const char *resp, void *ctx ) {
     char buf[10];
 
     if( resp ) {
-        if( rxv.decodeConfig(resp, power) ) {
-            snprintf(msg, sizeof(msg), "Got config while power is %s", power ? "on" : "off");
+        uint8_t changed[32];
+        if( rxv.decodeConfig(resp, power, changed) ) {
+            snprintf(msg, sizeof(msg), "Got config while power is %s (%u divergences in %u reconciles)",
+                power ? "on" : "off", rxv.divergences(), rxvcomm.reconciles());
             slog(msg);
+            snprintf(buf, sizeof(buf), "%u", rxv.divergences());
+            publish(MQTT_TOPIC "/status/Divergences", buf);
+#if STATE_JSON
+            publish_state();  // all values at once, corrections also go to their status topics
+#endif
             for( unsigned i=0; i<=0xff; i++ ) {
+                if( !(changed[i >> 3] & (1 << (i & 7))) ) continue;  // only publish corrections
                 name = rxv.report_name(i);
                 value = rxv.report_value_string(i);
                 if( name || value ) {
                     snprintf(msg, sizeof(msg), "Config x%02X: %s = %s", i, name ? name : "invalid", value ? value : "invalid");
                     slog(msg);
-                    if( name ) {
-                        snprintf(msg, sizeof(msg), MQTT_TOPIC "/status/%s", name);
-                        mqtt.publish(msg, value);
-                    }
+                    if( name ) status.changed(i);
                 }
             }
         }
@@ -730,7 +967,9 @@ void recvd( const char *resp, void *ctx ) {
 
             // "Speaker A Relay" only switches front left and right
             // Also silence center and back by switching to 2ch stereo effect
-            if( id == 0x2E ) {
+            // While the a-on or a-off scene runs, the scene already does that
+            // Sending from this callback is deferred until the report is handled
+            if( id == 0x2E && !speaker_scene() ) {
                 // Speaker A Relais
                 if( rxv.report_value(id) == 0x00 ) {  // Off
                     rxvcomm.send(rxv.command("DSP_2chStereo"));
@@ -740,21 +979,7 @@ void recvd( const char *resp, void *ctx ) {
                 }
             }
 
-            // Vol change is slow, and first request since 1s only reports current value
-            // Double request: so first changes by 0.5dB and further changes by 1dB 
-            if( id == 0x26 && first_vol != 0 ) {
-                if( first_vol > 0 ) {
-                    rxvcomm.send(rxv.command("MainVolume_Up"));
-                }
-                else {
-                    rxvcomm.send(rxv.command("MainVolume_Down"));
-                }
-                first_vol = 0;
-            }
-            else if( name ) {
-                snprintf(msg, sizeof(msg), MQTT_TOPIC "/status/%s", name);
-                publish(msg, value);
-            }
+            if( name ) status.changed(id);
         }
         else if( rxv.decodeText(resp, id, text) ) {
             name = rxv.display_name(id);
@@ -762,7 +987,7 @@ void recvd( const char *resp, void *ctx ) {
             slog(msg);
             if( name ) {
                 snprintf(msg, sizeof(msg), MQTT_TOPIC "/status/%s", name);
-                mqtt.publish(msg, text);
+                publish(msg, text);
             }
         }
         else {
@@ -771,17 +996,22 @@ void recvd( const char *resp, void *ctx ) {
         }
     }
     else {
+        // link is lost now: comm resyncs by itself, see link_changed()
         snprintf(msg, sizeof(msg), "TIMEOUT");
         slog(msg);
-        shouldReboot = millis();
-        if( shouldReboot == 0 ) {
-            shouldReboot--;
-        }
-        delayReboot = 60000;
     }
 }
 
 
+void link_changed( RxV1600Comm::link_t link, void *ctx ) {
+    const char *name = RxV1600Comm::link_name(link);
+    snprintf(msg, sizeof(msg), "Link %s", name);
+    slog(msg, link == RxV1600Comm::LINK_HEALTHY ? LOG_NOTICE : LOG_WARNING);
+    publish(MQTT_TOPIC "/status/Link", name);
+}
+
+
+// Returns name of the scene to start on pin change
 const char *pin_changed( bool is_high ) {
     static bool bt_has_powered_on = false;
 
@@ -796,36 +1026,23 @@ const char *pin_changed( bool is_high ) {
 
     if( is_high ) {
         // My pico-w signals a BT connection. Switch receiver to its bluetooth input port
-        const char *cmd = rxv.command("Input_Cbl-Sat");
-        if( !power ) {
-            rxvcomm.send(rxv.command("MainZonePower_On"));
-            bt_has_powered_on = true;
-            return cmd;  // call this later...
-        }
-        else {
-            bt_has_powered_on = false;
-            rxvcomm.send(cmd);
-        }
+        // Power on first, if needed, and remember to power off again on disconnect
+        bt_has_powered_on = !power;
+        return "bt";
     }
-    else {
-        // My pico-w signals BT connection lost. Switch receiver to its tv input port
-        rxvcomm.send(rxv.command("Input_Dtv"));
-        if( bt_has_powered_on ) {
-            bt_has_powered_on = false;
-            return rxv.command("MainZonePower_Off");
-        }
+
+    // My pico-w signals BT connection lost. Switch receiver to its tv input port
+    if( bt_has_powered_on ) {
+        bt_has_powered_on = false;
+        return "tv-off";
     }
 
-    return NULL;
+    return "tv";
 }
 
 
 void handle_pin() {
     static const uint32_t debounce_ms = 10;
-    static const uint32_t powered_ms = 5000;
-
-    static const char *cmd = NULL;
-    static uint32_t power_at = 0;
 
     static uint32_t changed = 0;
     static bool was_high = false;
@@ -842,10 +1059,7 @@ void handle_pin() {
             // waiting for debounce of pin state
             if( now - changed > debounce_ms ) {
                 // debounced: react on pin change
-                cmd = pin_changed(is_high);
-                if( cmd ) {
-                    power_at = (now - 1) | 1;
-                }
+                scenes.start(pin_changed(is_high));
                 was_high = is_high;  // remember last known state
             }
         }
@@ -853,15 +1067,16 @@ void handle_pin() {
     else {
         // pin state not changed or changed back within debounce period.
         changed = 0;  // reset debounce timer
-        if( cmd && power_at && now - power_at > powered_ms ) {
-            rxvcomm.send(cmd);
-            power_at = 0;
-            cmd = NULL;
-        } 
     }
 }
 
 
+void scene_done( const char *name, bool ok, void *ctx ) {
+    snprintf(msg, sizeof(msg), "Scene %s %s", name, ok ? "done" : "failed");
+    slog(msg, ok ? LOG_INFO : LOG_WARNING);
+}
+
+
 void setup() {
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
@@ -879,6 +1094,10 @@ void setup() {
     syslog.deviceHostname(WiFi.getHostname());
     syslog.appName("Joba1");
     syslog.defaultPriority(LOG_KERN);
+    health.log_queue = &log_queue;
+    log_queue.limit(LOG_INFO, LOG_INFO_MAX, 1000);
+    log_queue.limit(LOG_DEBUG, LOG_INFO_MAX, 1000);
+    xTaskCreatePinnedToCore(log_task, "log", 4096, NULL, tskIDLE_PRIORITY + 1, NULL, 0);  // loop() runs on core 1
 
     digitalWrite(LED_PIN, LOW);
 
@@ -915,6 +1134,13 @@ void setup() {
 
     Serial1.begin(9600, SERIAL_8N1, 16, 17);  // chosen arbitrary rx, tx pins
     rxvcomm.on_recv(recvd, NULL);
+    rxvcomm.on_link(link_changed, NULL);
+    rxvcomm.reconcile(RECONCILE_MS);
+    rxvcomm.capture(&capture);
+#if RXV1600_LOG_LEVEL > RXV1600_LOG_NONE
+    RxV1600Log::sink(log_line);
+#endif
+    scenes.on_done(scene_done, NULL);
     // Send ready to RX-V1600 to receive config
     rxvcomm.send(rxv.command("Ready"));
     Serial.println("Sent Ready message");
@@ -925,22 +1151,52 @@ void setup() {
 }
 
 
-void loop() {
-    static const uint32_t help_delay = 10;
-    static uint32_t prev_help = 0;
-
-    rxvcomm.handle();
-    handle_mqtt(check_ntptime());
-    handle_pin();
-    handle_wifi();
-    handle_reboot();
-    if( help != RxV1600::end() ) {
-        uint32_t now = millis();
-        if( now - prev_help > help_delay ) {
-            prev_help = now;
-            publish(MQTT_TOPIC "/help", help->first);
-            slog(help->first);
-            help++;
-        }
+// Count time between loop() calls into the loop histogram
+void measure_loop() {
+    static uint32_t prev_us = micros();
+
+    uint32_t now_us = micros();
+    uint32_t elapsed = now_us - prev_us;
+    health.loop_us[RxV1600Comm::bucket(elapsed)]++;
+    health.loop_us_sum += elapsed;
+    prev_us = now_us;
+}
+
+
+#ifdef RXV1600_PROFILE
+// Publish one handler profile per call every PROFILE_PUBLISH_MS, then restart profiling
+void publish_profile() {
+    static uint32_t prev_publish = 0;
+    static unsigned slot = 0;
+
+    if( slot == 0 && millis() - prev_publish < PROFILE_PUBLISH_MS ) return;
+
+    char topic[80];
+    snprintf(topic, sizeof(topic), MQTT_TOPIC "/status/Profile/%s", profiler.name(slot));
+    profiler.json(slot, msg, sizeof(msg));
+    publish(topic, msg);
+
+    if( ++slot == profiler.slots() ) {
+        slot = 0;
+        prev_publish = millis();
+        profiler.reset();
     }
 }
+#endif
+
+
+void loop() {
+    measure_loop();
+    RXV_PROFILE(profiler, P_COMM, rxvcomm.handle());
+    RXV_PROFILE(profiler, P_VOLUME, volume.handle());
+    RXV_PROFILE(profiler, P_SCENES, scenes.handle());
+    RXV_PROFILE(profiler, P_BATCH, batch.handle());
+    RXV_PROFILE(profiler, P_STATUS, status.handle());
+    RXV_PROFILE(profiler, P_MQTT, handle_mqtt(check_ntptime()));
+    RXV_PROFILE(profiler, P_PIN, handle_pin());
+    RXV_PROFILE(profiler, P_WIFI, handle_wifi());
+    RXV_PROFILE(profiler, P_REBOOT, handle_reboot());
+#ifdef RXV1600_PROFILE
+    publish_profile();
+#endif
+}
@@ -0,0 +1,231 @@
+// Mqtt serial gateway for several Yamaha RX-V1600 AV Receivers on one ESP32
+// Each receiver has its own serial port, RxV1600Comm and RxV1600 instance
+// and its own topic level below MQTT_TOPIC, e.g. MQTT_TOPIC "/2/cmd".
+
+#include <Arduino.h>
+
+#include <WiFi.h>
+#include <WiFiManager.h>
+#include <PubSubClient.h>
+
+#include <rxv1600.h>
+
+
+#define LED_PIN LED_BUILTIN
+
+#ifndef RECONCILE_MS
+#define RECONCILE_MS (5 * 60 * 1000)  // resync cached state with a Ready dump while idle
+#endif
+
+
+// Everything one receiver needs. The command and report tables of RxV1600 are shared
+class Receiver {
+    public:
+
+    Receiver( const char *name, HardwareSerial &serial, int8_t rx_pin, int8_t tx_pin ) :
+        name(name), serial(serial), rx_pin(rx_pin), tx_pin(tx_pin), comm(serial) {
+    }
+
+    const char *name;         // topic level of this receiver
+    HardwareSerial &serial;
+    int8_t rx_pin;
+    int8_t tx_pin;
+    RxV1600Comm comm;
+    RxV1600 rxv;
+};
+
+// UART0 is the console, so this leaves two UARTs for receivers (chosen arbitrary rx, tx pins)
+Receiver rx1("1", Serial1, 16, 17);
+Receiver rx2("2", Serial2, 25, 26);
+
+Receiver *receivers[] = { &rx1, &rx2 };
+const size_t RECEIVERS = sizeof(receivers) / sizeof(*receivers);
+
+
+WiFiClient wifiMqtt;
+PubSubClient mqtt(wifiMqtt);
+
+char msg[512];  // one buffer for all log and mqtt messages
+
+
+void publish( const Receiver &r, const char *name, const char *payload ) {
+    char topic[128];
+
+    snprintf(topic, sizeof(topic), MQTT_TOPIC "/%s/status/%s", r.name, name);
+    if( mqtt.connected() && !mqtt.publish(topic, payload ? payload : "") ) {
+        Serial.println("Mqtt publish failed");
+    }
+}
+
+
+void recvd( const char *resp, void *ctx ) {
+    Receiver &r = *(Receiver *)ctx;
+    bool power;
+    uint8_t id;
+    RxV1600::guard_t guard;
+    RxV1600::origin_t origin;
+    char text[9];
+    uint8_t changed[32];
+    const char *name;
+
+    if( !resp ) {
+        Serial.printf("Receiver %s: TIMEOUT\n", r.name);
+    }
+    else if( r.rxv.decodeConfig(resp, power, changed) ) {
+        Serial.printf("Receiver %s: got config while power is %s\n", r.name, power ? "on" : "off");
+        for( unsigned i=0; i<=0xff; i++ ) {
+            name = r.rxv.report_name(i);
+            if( name && (changed[i >> 3] & (1 << (i & 7))) ) {
+                publish(r, name, r.rxv.report_value_string(i));
+            }
+        }
+    }
+    else if( r.rxv.decode(resp, id, guard, origin) ) {
+        name = r.rxv.report_name(id);
+        if( name ) {
+            publish(r, name, r.rxv.report_value_string(id));
+        }
+    }
+    else if( r.rxv.decodeText(resp, id, text) ) {
+        name = r.rxv.display_name(id);
+        if( name ) {
+            publish(r, name, text);
+        }
+    }
+    else {
+        Serial.printf("Receiver %s: ignoring unknown response '%s'\n", r.name, resp);
+    }
+}
+
+
+void link_changed( RxV1600Comm::link_t link, void *ctx ) {
+    Receiver &r = *(Receiver *)ctx;
+    const char *name = RxV1600Comm::link_name(link);
+
+    Serial.printf("Receiver %s: link %s\n", r.name, name);
+    publish(r, "Link", name);
+}
+
+
+// Payload is Name[,value] as for Mqtt_RxV1600 (without volume ramps and scenes)
+void mqtt_callback( char *topic, byte *payload, unsigned int length ) {
+    static const char prefix[] = MQTT_TOPIC "/";
+
+    if( strncmp(topic, prefix, sizeof(prefix) - 1) != 0 ) return;
+    topic += sizeof(prefix) - 1;
+
+    Receiver *r = NULL;
+    for( size_t i=0; i<RECEIVERS; i++ ) {
+        size_t len = strlen(receivers[i]->name);
+        if( strncmp(topic, receivers[i]->name, len) == 0 && strcmp(&topic[len], "/cmd") == 0 ) {
+            r = receivers[i];
+            break;
+        }
+    }
+    if( !r ) return;
+
+    snprintf(msg, sizeof(msg), "%.*s", length, (char *)payload);
+    char *cmd_value = strchr(msg, ',');
+    const char *cmd;
+
+    if( cmd_value ) {
+        *(cmd_value++) = '\0';
+        char *endp;
+        unsigned long value = strtoul(cmd_value, &endp, 0);
+        cmd = (*endp || value > 0xff) ? NULL : r->rxv.command_value(msg, value);
+    }
+    else {
+        cmd = r->rxv.command(msg);
+    }
+
+    if( !cmd ) {
+        Serial.printf("Receiver %s: unknown mqtt payload '%.*s'\n", r->name, length, (char *)payload);
+    }
+    else if( !r->comm.send(cmd) ) {
+        Serial.printf("Receiver %s: discarding mqtt command '%s'\n", r->name, msg);
+    }
+}
+
+
+bool handle_mqtt() {
+    static const int32_t interval = 5000;  // if disconnected try reconnect this often in ms
+    static uint32_t prev = -interval;      // first connect attempt without delay
+
+    if (mqtt.connected()) {
+        mqtt.loop();
+        return true;
+    }
+
+    uint32_t now = millis();
+    if (now - prev > interval) {
+        prev = now;
+
+        if (mqtt.connect(HOSTNAME, MQTT_TOPIC "/status/LWT", 0, true, "Offline")
+            && mqtt.publish(MQTT_TOPIC "/status/LWT", "Online", true)
+            && mqtt.publish(MQTT_TOPIC "/status/Version", VERSION)
+            && mqtt.subscribe(MQTT_TOPIC "/+/cmd")) {
+            Serial.printf("Connected to MQTT broker %s:%d using topic %s\n", MQTT_SERVER, MQTT_PORT, MQTT_TOPIC);
+            return true;
+        }
+
+        Serial.printf("Connect to MQTT broker %s:%d failed with code %d\n", MQTT_SERVER, MQTT_PORT, mqtt.state());
+        mqtt.disconnect();
+    }
+
+    return false;
+}
+
+
+// Service all receivers once per call, starting with a different one each time,
+// so no receiver always gets its callbacks (and mqtt publishes) first
+void handle_receivers() {
+    static size_t first = 0;
+
+    for( size_t i=0; i<RECEIVERS; i++ ) {
+        receivers[(first + i) % RECEIVERS]->comm.handle();
+    }
+    first = (first + 1) % RECEIVERS;
+}
+
+
+void setup() {
+    pinMode(LED_PIN, OUTPUT);
+    digitalWrite(LED_PIN, HIGH);
+
+    Serial.begin(BAUDRATE);
+    Serial.println("\nStarting " PROGNAME " v" VERSION " " __DATE__ " " __TIME__);
+
+    WiFi.setHostname(HOSTNAME);
+    WiFi.mode(WIFI_STA);
+
+    WiFiManager wm;
+    wm.setConfigPortalTimeout(180);
+    if (!wm.autoConnect(WiFi.getHostname(), WiFi.getHostname())) {
+        Serial.println("Failed to connect WLAN, about to reset");
+        ESP.restart();
+        while (true)
+            ;
+    }
+    Serial.printf("%s WLAN IP is %s\n", HOSTNAME, WiFi.localIP().toString().c_str());
+
+    mqtt.setServer(MQTT_SERVER, MQTT_PORT);
+    mqtt.setCallback(mqtt_callback);
+
+    for( size_t i=0; i<RECEIVERS; i++ ) {
+        Receiver &r = *receivers[i];
+        r.serial.begin(9600, SERIAL_8N1, r.rx_pin, r.tx_pin);
+        r.comm.on_recv(recvd, &r);
+        r.comm.on_link(link_changed, &r);
+        r.comm.reconcile(RECONCILE_MS);
+        // Send ready to RX-V1600 to receive config
+        r.comm.send(r.rxv.command("Ready"));
+    }
+
+    digitalWrite(LED_PIN, LOW);
+}
+
+
+void loop() {
+    handle_receivers();
+    handle_mqtt();
+}
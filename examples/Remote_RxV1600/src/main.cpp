@@ -29,10 +29,6 @@
 #include <time.h>
 
 
-// Reset reason
-#include "rom/rtc.h"
-
-
 #define WEBSERVER_PORT 80
 
 AsyncWebServer web_server(WEBSERVER_PORT);
@@ -57,11 +53,93 @@ void mqtt_callback(char* topic, byte* payload, unsigned int length);
 
 
 #include <rxv1600.h>
+#include <rxv1600batch.h>
+#include <rxv1600volume.h>
+#include <rxv1600scene.h>
+#include <rxv1600coalescer.h>
+#include <rxv1600metrics.h>
+#include <rxv1600profiler.h>
+#include <rxv1600log.h>
+#include <rxv1600logqueue.h>
+#include <rxv1600web.h>
+
+#ifndef RECONCILE_MS
+#define RECONCILE_MS (5 * 60 * 1000)  // resync cached state with a Ready dump while idle
+#endif
+
+#ifndef CAPTURE_SIZE
+#define CAPTURE_SIZE (16 * 1024)  // bytes of serial traffic kept for download at /capture
+#endif
+
+#ifndef COALESCE_MS
+#define COALESCE_MS 200  // publish changes of a status topic at most once per window
+#endif
+
+#ifndef STATE_JSON
+#define STATE_JSON 1  // also publish config dumps as one JSON message to MQTT_TOPIC "/state"
+#endif
+
+#ifndef STATE_JSON_SIZE
+#define STATE_JSON_SIZE 2048  // max length of the /state message
+#endif
 
 RxV1600Comm rxvcomm(Serial1);
 RxV1600 rxv;
 
-int first_vol = 0;
+// Gateway health for /metrics, comm metrics come from rxvcomm
+RxV1600Web::health_t health = {};
+
+#ifdef RXV1600_PROFILE
+#ifndef PROFILE_PUBLISH_MS
+#define PROFILE_PUBLISH_MS (60 * 1000)  // publish and restart handler profiles
+#endif
+
+// Durations of the handlers called by loop(), at /profile and MQTT_TOPIC "/status/Profile/<name>"
+enum { P_COMM, P_VOLUME, P_SCENES, P_BATCH, P_STATUS, P_NTP, P_PIN, P_WIFI, P_REBOOT, P_MQTT };
+const char *const profile_names[] = { "comm", "volume", "scenes", "batch", "status", "ntp", "pin", "wifi", "reboot", "mqtt" };
+RxV1600Profiler profiler(profile_names, sizeof(profile_names) / sizeof(*profile_names));
+#endif
+
+uint8_t capture_buf[CAPTURE_SIZE];
+RxV1600Capture capture(capture_buf, sizeof(capture_buf));  // replay downloads with rxv1600replay
+RxV1600Volume volume(rxvcomm, rxv);
+
+// Retained status topics, published on change only
+void publish_status(uint8_t id, void *ctx);
+RxV1600Coalescer status(rxv, COALESCE_MS, publish_status);
+
+
+// Scenes, triggered by mqtt payload "scene,<name>", web page /scene or the bluetooth pin
+const RxV1600Scene::step_t SCENE_BT[] = {
+    RXV_CMD("MainZonePower_On"), RXV_READY(0, 8000), RXV_CMD("Input_Cbl-Sat"), RXV_END };
+const RxV1600Scene::step_t SCENE_TV[] = {
+    RXV_CMD("Input_Dtv"), RXV_END };
+const RxV1600Scene::step_t SCENE_TV_OFF[] = {
+    RXV_CMD("Input_Dtv"), RXV_CMD("MainZonePower_Off"), RXV_END };
+// Speaker A relay only switches front left and right, so also switch center and back by DSP
+const RxV1600Scene::step_t SCENE_A_ON[] = {
+    RXV_CMD("SpeakerRelayA_On"), RXV_WAIT(0x2E, RXV_BIT(1), 2000), RXV_CMD("DSP_Adventure"), RXV_END };
+const RxV1600Scene::step_t SCENE_A_OFF[] = {
+    RXV_CMD("SpeakerRelayA_Off"), RXV_WAIT(0x2E, RXV_BIT(0), 2000), RXV_CMD("DSP_2chStereo"), RXV_END };
+
+const RxV1600Scene::scene_t SCENES[] = {
+    { "bt",     SCENE_BT },
+    { "tv",     SCENE_TV },
+    { "tv-off", SCENE_TV_OFF },
+    { "a-on",   SCENE_A_ON },
+    { "a-off",  SCENE_A_OFF }
+};
+
+RxV1600Scene scenes(rxvcomm, rxv, SCENES, sizeof(SCENES) / sizeof(*SCENES));
+RxV1600Batch batch(rxvcomm);  // commands of mqtt payloads, queued per message
+
+
+// true while a scene switches speaker A together with the DSP mode
+bool speaker_scene() {
+    const char *name = scenes.running();
+    return name && (strcmp(name, "a-on") == 0 || strcmp(name, "a-off") == 0);
+}
+
 char last_sent_cmd[128] = "";
 
 
@@ -85,35 +163,110 @@ constexpr char IsoDate[] = {
 };
 
 
+#ifndef LOG_CELLS
+#define LOG_CELLS 64  // log lines waiting for log_task(), power of 2
+#endif
+
+#ifndef LOG_INFO_MAX
+#define LOG_INFO_MAX 100  // info and debug lines per second, more are dropped
+#endif
+
+// Log lines are queued, so logging never blocks loop() or web server callbacks
+RxV1600LogQueue::cell_t log_cells[LOG_CELLS];
+RxV1600LogQueue log_queue(log_cells, LOG_CELLS);
+
+
 void slog(const char *message, uint16_t pri = LOG_INFO) {
-    static bool log_infos = true;
+    log_queue.push(pri, message);
+}
 
-    if (pri < LOG_INFO || log_infos) {
-        Serial.println(message);
-        syslog.log(pri, message);
-    }
 
-    if (log_infos && millis() > 10 * 60 * 1000) {
-        log_infos = false;
-        slog("Switch off info level messages", LOG_NOTICE);
+// Low priority task writing queued log lines to Serial and syslog
+void log_task(void *param) {
+    char line[RxV1600LogQueue::TEXT_MAX];
+    unsigned pri;
+    uint32_t reported = 0;
+
+    for (;;) {
+        while (log_queue.pop(pri, line, sizeof(line))) {
+            Serial.println(line);
+            syslog.log(pri, line);
+        }
+
+        uint32_t dropped = log_queue.dropped();
+        if (dropped != reported) {
+            snprintf(line, sizeof(line), "Dropped %u log lines", (unsigned)(dropped - reported));
+            Serial.println(line);
+            syslog.log(LOG_WARNING, line);
+            reported = dropped;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
 
 
-void publish(const char *topic, const char *payload) {
-    if (mqtt.connected() && !mqtt.publish(topic, payload)) {
+void publish(const char *topic, const char *payload, bool retained = false) {
+    if (mqtt.connected() && !mqtt.publish(topic, payload, retained)) {
+        health.mqtt_publish_failures++;
         slog("Mqtt publish failed");
     }
 }
 
-// dbg_printf used by lower-level comm module to route debug messages
-// Disabled in production builds to avoid verbose console/syslog noise.
-void dbg_printf(const char *fmt, ...) {
-    (void)fmt;
-    // intentionally no-op
+
+#if STATE_JSON
+// Publish all known report values as one retained message, streamed since it exceeds the mqtt buffer
+void publish_state() {
+    static char json[STATE_JSON_SIZE];
+
+    size_t len = rxv.state_json(json, sizeof(json));
+    if (len >= sizeof(json)) {
+        slog("State exceeds STATE_JSON_SIZE", LOG_WARNING);
+        return;
+    }
+    if (mqtt.connected()) {
+        if (!mqtt.beginPublish(MQTT_TOPIC "/state", len, true)
+                || mqtt.write((const uint8_t *)json, len) != len
+                || !mqtt.endPublish()) {
+            health.mqtt_publish_failures++;
+            slog("Mqtt publish failed");
+        }
+    }
+}
+#endif
+
+
+// Publish the current value of a report to its retained status topic
+void publish_status(uint8_t id, void *ctx) {
+    const char *name = rxv.report_name(id);
+    const char *value = rxv.report_value_string(id);
+    char topic[80];
+    char buf[10];
+
+    if (!name) return;
+    if (!value) {
+        snprintf(buf, sizeof(buf), "raw %u", rxv.report_value(id));
+        value = buf;
+    }
+    snprintf(topic, sizeof(topic), MQTT_TOPIC "/status/%s", name);
+    publish(topic, value, true);
 }
 
 
+// Publish the command catalog as one retained message, streamed since it exceeds the mqtt buffer
+void publish_catalog() {
+    size_t len = RxV1600::catalog_length();
+
+    if (mqtt.connected()) {
+        if (!mqtt.beginPublish(MQTT_TOPIC "/commands", len, true)
+                || mqtt.write((const uint8_t *)RxV1600::catalog(), len) != len
+                || !mqtt.endPublish()) {
+            health.mqtt_publish_failures++;
+            slog("Mqtt publish failed");
+        }
+    }
+}
+
 // JSON helper: escape a string value (handles NULL)
 const char *js(const char *s) {
     return s ? s : "";
@@ -128,6 +281,7 @@ bool send_cmd(const char *name) {
         slog(msg);
         return false;
     }
+    volume.cancel();  // user command stops fading
     if (!rxvcomm.send(cmd)) {
         snprintf(msg, sizeof(msg), "Busy, discarding command '%s'", name);
         slog(msg);
@@ -142,28 +296,6 @@ bool send_cmd(const char *name) {
 }
 
 
-// Send a value command to RX-V1600. Returns true on send, false if busy/invalid.
-bool send_cmd_value(const char *name, uint8_t value) {
-    const char *cmd = rxv.command_value(name, value);
-    if (!cmd) {
-        snprintf(msg, sizeof(msg), "No command mapping for '%s' value %u", name, value);
-        slog(msg);
-        return false;
-    }
-    if (!rxvcomm.send(cmd)) {
-        snprintf(msg, sizeof(msg), "Busy, discarding command '%s,%u'", name, value);
-        slog(msg);
-        return false;
-    }
-    // record raw command sent for debugging
-    strncpy(last_sent_cmd, cmd, sizeof(last_sent_cmd)-1);
-    last_sent_cmd[sizeof(last_sent_cmd)-1] = '\0';
-    snprintf(msg, sizeof(msg), "Sent command '%s,%u'", name, value);
-    slog(msg);
-    return true;
-}
-
-
 const char* afterLastSpace(const char* s) {
     if (!s) return nullptr;
     const char* p = strrchr(s, ' ');
@@ -194,12 +326,16 @@ void send_state(AsyncWebServerRequest *request) {
         "\"volume\":\"%s\",\"volDb\":%d,"
         "\"version\":\"" VERSION "\","
         "\"heap\":%u,"
+        "\"blocked\":%u,\"blockedMs\":%u,"
+        "\"link\":\"%s\",\"reconciles\":%u,\"divergences\":%u,"
         "\"started\":\"%s\","
         "\"built\":\"%s\"}",
         power, input, speaker_a, speaker_b,
         night, mute,
         volume ? volume : "", vol_raw,
         ESP.getFreeHeap(),
+        rxvcomm.blocked_count(), rxvcomm.blocked_ms(),
+        RxV1600Comm::link_name(rxvcomm.link()), rxvcomm.reconciles(), rxv.divergences(),
         start_time, IsoDate);
 
     request->send(200, "application/json", json);
@@ -381,12 +517,8 @@ document.addEventListener('DOMContentLoaded', function() {
         btn.addEventListener('pointercancel', function(e){ volStop(); });
     });
 
-    var pending=null,inflight=false,volQ=[],volBusy=false,volTimer=null;
-    // Multi-inflight repeat control
-    var volInflight = []; // array of {dir,sentAt,retries}
-    var volMaxInflight = 3; // allow up to 3 inflight volume steps (tuned)
-    var volCmdTimeout = 1200; // ms to wait for feedback before retry
-    var volMaxRetries = 2; // retry count per command
+    var pending=null,inflight=false,volBusy=false,volTimer=null;
+    // Volume steps are coalesced by the server, so no client side queueing
     var volRepeatInterval = 140; // ms between auto-repeat steps when holding (tuned)
   function ajax(m,u,d,cb){
     var x=new XMLHttpRequest();
@@ -420,64 +552,13 @@ document.addEventListener('DOMContentLoaded', function() {
             // no-op callback; server will update state which poll() will pick up
         });
   }
-  function volNext(){
-        // Send up to volMaxInflight steps in parallel.
-        if(!volQ.length && sliderQueueLatest === null){
-            volTimer=setTimeout(poll,500);
-            return;
-        }
-        while((volQ.length || sliderQueueLatest !== null) && volInflight.length < volMaxInflight){
-            // If there's a pending slider set, prioritize it over step queue
-            if(sliderQueueLatest !== null){
-                var v = sliderQueueLatest; sliderQueueLatest = null;
-                var entry = {type:'set', value: v, sentAt: Date.now(), retries: 0};
-                volInflight.push(entry);
-                window.debuglog('[volNext] sending set ' + v + ' (inflight=' + volInflight.length + ')');
-                ajax('POST','/vol','v='+v,function(){});
-                (function(e){ setTimeout(function(){ checkInflightTimeout(e); }, volCmdTimeout); })(entry);
-                continue;
-            }
-            var v = volQ.shift();
-            var entry = {type:'step', dir: v, sentAt: Date.now(), retries: 0};
-            volInflight.push(entry);
-            window.debuglog('[volNext] sending ' + (v > 0 ? 'up' : 'down') + ' (inflight=' + volInflight.length + ')');
-            ajax('POST', v>0?'/vol-up':'/vol-down', null, function(){});
-            (function(e){ setTimeout(function(){ checkInflightTimeout(e); }, volCmdTimeout); })(entry);
-        }
-  }
-
-  function checkInflightTimeout(entry){
-      // find entry in volInflight (may have been removed by poll)
-      for(var i=0;i<volInflight.length;i++){
-          if(volInflight[i]===entry){
-              var now = Date.now();
-              if(now - entry.sentAt >= volCmdTimeout){
-                  if(entry.retries < volMaxRetries){
-                      entry.retries++;
-                      entry.sentAt = Date.now();
-                      if(entry.type === 'step'){
-                          window.debuglog('[volRetry] retrying ' + (entry.dir>0?'up':'down') + ' (retry=' + entry.retries + ')');
-                          ajax('POST', entry.dir>0?'/vol-up':'/vol-down', null, function(){});
-                      } else if(entry.type === 'set'){
-                          window.debuglog('[volRetry] retrying set ' + entry.value + ' (retry=' + entry.retries + ')');
-                          ajax('POST', '/vol', 'v='+entry.value, function(){});
-                      }
-                      // schedule another timeout check
-                      (function(e){ setTimeout(function(){ checkInflightTimeout(e); }, volCmdTimeout); })(entry);
-                  } else {
-                      // drop it after max retries
-                      if(entry.type === 'step') window.debuglog('[volRetry] dropping ' + (entry.dir>0?'up':'down') + ' after retries');
-                      else window.debuglog('[volRetry] dropping set ' + entry.value + ' after retries');
-                      volInflight.splice(i,1);
-                      // try to send next queued steps
-                      setTimeout(volNext,50);
-                  }
-              }
-              break;
-          }
-      }
+  function volSend(u,d){
+        // server merges bursts into one absolute volume set, just fire
+        ajax('POST',u,d,function(){});
+        if(volTimer) clearTimeout(volTimer);
+        volTimer=setTimeout(poll,500);
   }
-  var volRepTimer=null,volRepDir=0,volNoFeedback=0,volRepeatLimit=3;
+  var volRepTimer=null,volRepDir=0;
   var volLastStep=0;
     function volRepeat(d){
         // Ignore duplicate start if already repeating in same direction
@@ -485,7 +566,6 @@ document.addEventListener('DOMContentLoaded', function() {
         volRepDir=d;
         volStep(d);
         function rep(){
-            if(volNoFeedback>=volRepeatLimit) return;
             var now = Date.now();
             if(now - volLastStep < volRepeatInterval){
                     volRepTimer = setTimeout(rep, volRepeatInterval - (now - volLastStep));
@@ -500,20 +580,12 @@ document.addEventListener('DOMContentLoaded', function() {
   }
     function volStop(){
         if(volRepTimer){clearTimeout(volRepTimer);volRepTimer=null;}
-                volQ=[]; // Immediately stop pending changes
-                volNoFeedback=0;
-                volInflight = []; // clear inflight commands
+        volRepDir=0;
     }
   function volStep(d){
-        window.debuglog('[volStep] dir: ' + d + ' queue: ' + volQ.length + ' noFeedback: ' + volNoFeedback);
-        // cap total outstanding steps (queued + inflight)
-        var infl = Array.isArray(volInflight) ? volInflight.length : 0;
-        if(volQ.length + infl >= 4) return;
-        volQ.push(d);
+        window.debuglog('[volStep] dir: ' + d);
         volLastStep=Date.now();
-        // try to send immediately if allowed
-        if(volTimer) clearTimeout(volTimer);
-        setTimeout(volNext, 0);
+        volSend(d>0?'/vol-up':'/vol-down',null);
   }
     var sl=document.getElementById('vol-slider'),slBusy=false;
     // Track when the user is actively manipulating the slider to avoid
@@ -521,7 +593,6 @@ document.addEventListener('DOMContentLoaded', function() {
     // POST frequency.
     var slUserInteracting=false, slDebounceTimer=null;
     var slLastSentVol=null, slSentAt=0;
-    var sliderQueueLatest = null;
     function sendSliderImmediate(cb){
         slBusy=true;
         // record last sent value and timestamp so poll can be patient
@@ -531,24 +602,12 @@ document.addEventListener('DOMContentLoaded', function() {
     }
 
     function trySendSlider(){
-        var v = (sliderQueueLatest !== null) ? sliderQueueLatest : parseInt(sl.value,10);
+        var v = parseInt(sl.value,10);
         if(isNaN(v)) return;
-        // if we have capacity, send immediately as an inflight 'set' entry
-        if(volInflight.length < volMaxInflight){
-            var entry = { type: 'set', value: v, sentAt: Date.now(), retries: 0 };
-            volInflight.push(entry);
-            window.debuglog('[slider] sending set ' + v + ' (inflight=' + volInflight.length + ')');
-            // record last sent for UI patience
-            slLastSentVol = v; slSentAt = Date.now();
-            ajax('POST','/vol','v='+v,function(){});
-            // schedule timeout check
-            (function(e){ setTimeout(function(){ checkInflightTimeout(e); }, volCmdTimeout); })(entry);
-            sliderQueueLatest = null;
-        } else {
-            // no capacity: remember latest to send later
-            sliderQueueLatest = v;
-            window.debuglog('[slider] queued set ' + v + ' (queued)');
-        }
+        window.debuglog('[slider] sending set ' + v);
+        // record last sent for UI patience
+        slLastSentVol = v; slSentAt = Date.now();
+        volSend('/vol','v='+v);
     }
     // Pointer/mouse/touch start
     sl.addEventListener('pointerdown', function(){ slUserInteracting=true; });
@@ -557,8 +616,7 @@ document.addEventListener('DOMContentLoaded', function() {
     // Pointer/mouse/touch end: cancel debounce and send final value
     function finishSlider(){
         if(slDebounceTimer){ clearTimeout(slDebounceTimer); slDebounceTimer=null; }
-        // ensure final value is sent (will use inflight queue)
-        sliderQueueLatest = parseInt(sl.value,10);
+        // ensure final value is sent
         trySendSlider();
         // poll to refresh UI after finalization
         setTimeout(poll,200);
@@ -579,8 +637,6 @@ document.addEventListener('DOMContentLoaded', function() {
         if(slDebounceTimer) clearTimeout(slDebounceTimer);
         slDebounceTimer = setTimeout(function(){
             slDebounceTimer = null;
-            // queue/send slider value with the same inflight throttling as vol repeats
-            sliderQueueLatest = parseInt(sl.value,10);
             trySendSlider();
         }, 100);
     };
@@ -623,7 +679,6 @@ document.addEventListener('DOMContentLoaded', function() {
          }
          else if(now - slSentAt < 2000){
              window.debuglog('[poll] delayed feedback, ignoring reported vol ' + reported);
-             volNoFeedback=0;
              // skip updating slider
              reported = null;
          }
@@ -640,19 +695,6 @@ document.addEventListener('DOMContentLoaded', function() {
              window.debuglog('[poll] skipping slider update during interaction/busy');
          }
      }
-        window.debuglog('[poll] feedback received, reset noFeedback');
-        volNoFeedback=0; // Reset no-feedback counter on feedback
-        // If we were waiting for feedback for sent vol commands, decrement
-        // inflight and try to send more queued steps.
-        if(Array.isArray(volInflight) && volInflight.length>0){
-            // consume one inflight confirmation
-            volInflight.shift();
-            window.debuglog('[poll] confirmed one inflight (remaining=' + volInflight.length + ')');
-        }
-        if(volQ.length || sliderQueueLatest !== null){
-            // send next available steps or pending slider set
-            setTimeout(volNext, 50);
-        }
     }
   document.getElementById('ver').textContent = s.version;
 document.getElementById('info').innerHTML =
@@ -736,14 +778,12 @@ void setup_webserver() {
 
     // Speakers
     web_server.on("/a-on", HTTP_POST, [](AsyncWebServerRequest *request) {
-        bool ok = send_cmd("SpeakerRelayA_On");
-        if(ok) request->send(200, "text/plain", last_sent_cmd);
-        else request->send(503, "text/plain", "BUSY");
+        scenes.start("a-on");
+        request->send(200, "text/plain", "OK");
     });
     web_server.on("/a-off", HTTP_POST, [](AsyncWebServerRequest *request) {
-        bool ok = send_cmd("SpeakerRelayA_Off");
-        if(ok) request->send(200, "text/plain", last_sent_cmd);
-        else request->send(503, "text/plain", "BUSY");
+        scenes.start("a-off");
+        request->send(200, "text/plain", "OK");
     });
     web_server.on("/b-on", HTTP_POST, [](AsyncWebServerRequest *request) {
         bool ok = send_cmd("SpeakerRelayB_On");
@@ -789,28 +829,59 @@ void setup_webserver() {
 
     // Volume
     web_server.on("/vol-up", HTTP_POST, [](AsyncWebServerRequest *request) {
-        first_vol = 1;
-        bool ok = send_cmd("MainVolume_Up");
-        if(ok) request->send(200, "text/plain", last_sent_cmd);
+        // sent later as newest volume target, or relative while the volume is unknown
+        if (volume.command("MainVolume_Up")) request->send(200, "text/plain", "OK");
+        else if (send_cmd("MainVolume_Up")) request->send(200, "text/plain", last_sent_cmd);
         else request->send(503, "text/plain", "BUSY");
     });
     web_server.on("/vol-down", HTTP_POST, [](AsyncWebServerRequest *request) {
-        first_vol = -1;
-        bool ok = send_cmd("MainVolume_Down");
-        if(ok) request->send(200, "text/plain", last_sent_cmd);
+        // sent later as newest volume target, or relative while the volume is unknown
+        if (volume.command("MainVolume_Down")) request->send(200, "text/plain", "OK");
+        else if (send_cmd("MainVolume_Down")) request->send(200, "text/plain", last_sent_cmd);
         else request->send(503, "text/plain", "BUSY");
     });
     web_server.on("/vol", HTTP_POST, [](AsyncWebServerRequest *request) {
         String arg = request->arg("v");
-        bool ok = false;
         if (!arg.isEmpty()) {
-            int volume = atoi(arg.c_str());
-            char cmd[30];
-            snprintf(cmd, sizeof(cmd), "MainVolumeSet,%d", volume * 2 + 199);
-            ok = send_cmd_value("MainVolumeSet", volume * 2 + 199);
+            int db = atoi(arg.c_str());
+            volume.set(RxV1600Volume::Z_MAIN, constrain(db * 2 + 199, 0, 0xff));
+            request->send(200, "text/plain", "OK");
         }
-        if(ok) request->send(200, "text/plain", last_sent_cmd);
-        else request->send(503, "text/plain", "BUSY");
+        else request->send(400, "text/plain", "MISSING");
+    });
+
+    // Fade to dB value v within s seconds, optional curve linear, in, out or smooth
+    web_server.on("/fade", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String vol = request->arg("v");
+        String secs = request->arg("s");
+        String curve = request->arg("curve");
+        if (vol.isEmpty() || secs.isEmpty()) {
+            request->send(400, "text/plain", "MISSING");
+            return;
+        }
+        bool ok = volume.ramp(RxV1600Volume::Z_MAIN, constrain(atoi(vol.c_str()) * 2 + 199, 0, 0xff),
+            secs.toFloat() * 1000, curve.isEmpty() ? RxV1600Volume::C_LINEAR : RxV1600Volume::ramp_curve(curve.c_str()));
+        if(ok) request->send(200, "text/plain", "OK");
+        else request->send(503, "text/plain", "UNKNOWN");
+    });
+
+    // Sleep: fade out within m minutes, then power off main zone
+    web_server.on("/sleep", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String mins = request->arg("m");
+        if (mins.isEmpty()) {
+            request->send(400, "text/plain", "MISSING");
+            return;
+        }
+        bool ok = volume.ramp(RxV1600Volume::Z_MAIN, 0, mins.toInt() * 60000, RxV1600Volume::C_EASE_IN, "MainZonePower_Off");
+        if(ok) request->send(200, "text/plain", "OK");
+        else request->send(503, "text/plain", "UNKNOWN");
+    });
+
+    // Scenes
+    web_server.on("/scene", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String name = request->arg("name");
+        if (scenes.start(name.c_str())) request->send(200, "text/plain", "OK");
+        else request->send(404, "text/plain", "UNKNOWN");
     });
 
     // Reset
@@ -891,6 +962,15 @@ void setup_webserver() {
         }
     });
 
+    // Command catalog, metrics, profile and capture download
+    static const char etag[] = "\"" VERSION " " __DATE__ " " __TIME__ "\"";
+    RxV1600Web::commands(web_server, etag);
+    RxV1600Web::metrics(web_server, rxvcomm, health);
+#ifdef RXV1600_PROFILE
+    RxV1600Web::profile(web_server, profiler);
+#endif
+    RxV1600Web::capture(web_server, capture);
+
     web_server.onNotFound([](AsyncWebServerRequest *request) {
         request->send(404, "text/plain", "Not found");
     });
@@ -917,6 +997,7 @@ bool handle_wifi() {
         uint32_t now = millis();
         if (reconnectCount == 0 || now - reconnectPrev > reconnectInterval) {
             WiFi.reconnect();
+            health.wifi_reconnects++;
             reconnectCount++;
             if (reconnectCount > reconnectLimit) {
                 Serial.println("Failed to reconnect WLAN, about to reset");
@@ -957,24 +1038,7 @@ bool check_ntptime() {
 
 
 void print_reset_reason(int core) {
-    switch (rtc_get_reset_reason(core)) {
-        case 1  : slog("Vbat power on reset"); break;
-        case 3  : slog("Software reset digital core"); break;
-        case 4  : slog("Legacy watch dog reset digital core"); break;
-        case 5  : slog("Deep Sleep reset digital core"); break;
-        case 6  : slog("Reset by SLC module, reset digital core"); break;
-        case 7  : slog("Timer Group0 Watch dog reset digital core"); break;
-        case 8  : slog("Timer Group1 Watch dog reset digital core"); break;
-        case 9  : slog("RTC Watch dog Reset digital core"); break;
-        case 10 : slog("Instrusion tested to reset CPU"); break;
-        case 11 : slog("Time Group reset CPU"); break;
-        case 12 : slog("Software reset CPU"); break;
-        case 13 : slog("RTC Watch dog Reset CPU"); break;
-        case 14 : slog("for APP CPU, reseted by PRO CPU"); break;
-        case 15 : slog("Reset when the vdd voltage is not stable"); break;
-        case 16 : slog("RTC Watch dog reset digital core and rtc module"); break;
-        default : slog("Reset reason unknown");
-    }
+    slog(RxV1600Web::reset_reason(core));
 }
 
 
@@ -989,94 +1053,101 @@ void handle_reboot() {
 }
 
 
-// Called on incoming mqtt messages
-void mqtt_callback(char* topic, byte* payload, unsigned int length) {
-    if (strcasecmp(MQTT_TOPIC "/cmd", topic) == 0) {
-        // copy payload to a safe, null-terminated buffer
-        char original[256];
-        size_t plen = (length < sizeof(original)-1) ? length : (sizeof(original)-1);
-        memcpy(original, payload, plen);
-        original[plen] = '\0';
+// Start a volume ramp from remaining payload fields "value,seconds[,curve[,command]]"
+bool ramp_command(RxV1600Volume::zone_t zone, RxV1600Batch::span_t rest) {
+    RxV1600Batch::span_t field;
+    char value[8], seconds[16], curve[16], then[RxV1600Batch::NAME_MAX];
+    bool has_curve, has_then;
 
-        snprintf(msg, sizeof(msg), "MQTT received on %s: '%s'", topic, original);
-        slog(msg);
+    if (!RxV1600Batch::split(rest, field) || !RxV1600Batch::copy(field, value, sizeof(value))) return false;
+    if (!RxV1600Batch::split(rest, field) || !RxV1600Batch::copy(field, seconds, sizeof(seconds))) return false;
+    if ((has_curve = RxV1600Batch::split(rest, field)) && !RxV1600Batch::copy(field, curve, sizeof(curve))) return false;
+    if ((has_then = RxV1600Batch::split(rest, field)) && !RxV1600Batch::copy(field, then, sizeof(then))) return false;
+    if (rest.str || !*value || !*seconds) return false;
+
+    char *endp;
+    unsigned long raw = strtoul(value, &endp, 0);
+    if (*endp || raw > 0xff) return false;
+    double secs = strtod(seconds, &endp);
+    if (*endp || secs < 0 || secs > 24 * 3600) return false;
+
+    return volume.ramp(zone, raw, secs * 1000, has_curve ? RxV1600Volume::ramp_curve(curve) : RxV1600Volume::C_LINEAR, has_then ? then : NULL);
+}
+
+
+// Handle a payload with one gateway command: volume ramp or target, scene, help or reset
+// Returns false if the payload is for the command batch queue
+bool gateway_command(const char *payload, unsigned int length) {
+    RxV1600Batch::cursor_t cur;
+    RxV1600Batch::span_t item, rest, field;
+    char name[RxV1600Batch::NAME_MAX];
 
-        // parse name[,value]
-        char tmp[256];
-        strncpy(tmp, original, sizeof(tmp)-1);
-        tmp[sizeof(tmp)-1] = '\0';
+    RxV1600Batch::begin(cur, payload, length);
+    if (!RxV1600Batch::next(cur, item) || RxV1600Batch::next(cur, rest) || cur.error) return false;
 
-        char *cmd_name = std::strtok(tmp, ",");
-        char *cmd_value = std::strtok(NULL, ",");
-        bool cmd_excess = (std::strtok(NULL, ",") != NULL);
+    rest = item;
+    RxV1600Batch::split(rest, field);
+    if (!RxV1600Batch::copy(field, name, sizeof(name))) return false;
 
-        if (cmd_name == NULL) {
-            snprintf(msg, sizeof(msg), "Empty mqtt payload on %s", topic);
+    RxV1600Volume::zone_t zone;
+    if (RxV1600Volume::ramp_zone(name, zone)) {
+        if (!ramp_command(zone, rest)) {
+            snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': invalid ramp", length, payload);
             slog(msg, LOG_WARNING);
-            return;
         }
+        return true;
+    }
 
-        snprintf(msg, sizeof(msg), "Parsed mqtt payload: name='%s'%s", cmd_name, cmd_value ? ", with value" : "");
-        slog(msg);
-
-        const char *resolved = NULL;
+    if (strcasecmp("scene", name) == 0) {
+        char scene[16];
+        if (!RxV1600Batch::split(rest, field) || !RxV1600Batch::copy(field, scene, sizeof(scene)) || !scenes.start(scene)) {
+            snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': unknown scene", length, payload);
+            slog(msg, LOG_WARNING);
+        }
+        return true;
+    }
 
-        if (cmd_value) {
-            if (cmd_excess) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt payload '%s': excess argument", original);
-                slog(msg, LOG_WARNING);
-                return;
-            }
-            size_t value_len = strlen(cmd_value);
-            char *endp;
-            unsigned long value = strtoul(cmd_value, &endp, 0);
-            if (endp != &cmd_value[value_len]) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt payload '%s': invalid numeric value", original);
-                slog(msg, LOG_WARNING);
-                return;
-            }
-            else if (value > 0xff) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt payload '%s': value overflow", original);
-                slog(msg, LOG_WARNING);
-                return;
-            }
-            else {
-                resolved = rxv.command_value(cmd_name, (uint8_t)value);
-            }
+    if (!rest.str) {
+        if (strcasecmp("help", name) == 0) {
+            publish_catalog();
+            return true;
         }
-        else {
-            resolved = rxv.command(cmd_name);
+        if (strcasecmp("reset", name) == 0) {
+            slog("RESET via MQTT", LOG_NOTICE);
+            delay(100);
+            Serial1.end();
+            ESP.restart();
         }
+        return volume.command(name);  // sent later as newest volume target
+    }
 
-        if (resolved) {
-            snprintf(msg, sizeof(msg), "Resolved mqtt command '%s' -> %s", cmd_name, resolved);
-            slog(msg);
-            bool sent = rxvcomm.send(resolved);
-            if (!sent) {
-                snprintf(msg, sizeof(msg), "Discarding mqtt command '%s' (device busy)", cmd_name);
-                slog(msg, LOG_WARNING);
-            }
-            else {
-                snprintf(msg, sizeof(msg), "Sent mqtt command '%s'", cmd_name);
-                slog(msg, LOG_INFO);
-            }
+    char value[8];
+    char *endp;
+    if (!RxV1600Batch::split(rest, field) || rest.str || !RxV1600Batch::copy(field, value, sizeof(value))) return false;
+    unsigned long number = strtoul(value, &endp, 0);
+    return *value && !*endp && number <= 0xff && volume.command_value(name, number);  // sent later as newest volume target
+}
+
+
+// Called on incoming mqtt messages
+// Payload is one command "Name[,value]" or a batch: lines separated by newline or ';', or a JSON array of them
+void mqtt_callback(char* topic, byte* payload, unsigned int length) {
+    if (strcasecmp(MQTT_TOPIC "/cmd", topic) == 0) {
+        snprintf(msg, sizeof(msg), "MQTT received on %s: '%.*s'", topic, length, (char *)payload);
+        slog(msg);
+
+        if (gateway_command((const char *)payload, length)) return;
+
+        unsigned failed;
+        RxV1600Batch::error_t error = batch.submit((const char *)payload, length, &failed);
+        if (error) {
+            snprintf(msg, sizeof(msg), "Discarding mqtt payload '%.*s': %s at command %u", length, (char *)payload, RxV1600Batch::error_name(error), failed + 1);
+            slog(msg, LOG_WARNING);
         }
         else {
-            // handle special textual payloads
-            if (strcasecmp("help", original) == 0) {
-                snprintf(msg, sizeof(msg), "MQTT help requested (ignored)");
-                slog(msg);
-            }
-            else if (strcasecmp("reset", original) == 0) {
-                slog("RESET via MQTT", LOG_NOTICE);
-                delay(100);
-                Serial1.end();
-                ESP.restart();
-            }
-            else {
-                snprintf(msg, sizeof(msg), "Ignore unknown mqtt payload '%s'", original);
-                slog(msg, LOG_WARNING);
-            }
+            volume.cancel();  // user command stops fading
+            snprintf(msg, sizeof(msg), "Queued mqtt batch, %u commands pending", batch.pending());
+            slog(msg, LOG_INFO);
         }
     }
     else {
@@ -1109,6 +1180,9 @@ bool handle_mqtt(bool time_valid) {
                 && mqtt.subscribe(MQTT_TOPIC "/cmd") ) {
             snprintf(msg, sizeof(msg), "Connected to MQTT broker %s:%d using topic %s", MQTT_SERVER, MQTT_PORT, MQTT_TOPIC);
             slog(msg, LOG_NOTICE);
+            health.mqtt_connects++;
+            status.republish();  // in case the broker lost retained values
+            publish_catalog();
             return true;
         }
 
@@ -1122,6 +1196,15 @@ bool handle_mqtt(bool time_valid) {
 }
 
 
+#if RXV1600_LOG_LEVEL > RXV1600_LOG_NONE
+// Library log lines to the log queue with matching syslog priority
+void log_line(RxV1600Log::level_t level, const char *line, void *ctx) {
+    static const uint16_t pri[] = { LOG_ERR, LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG };
+    log_queue.push(pri[level], line);
+}
+#endif
+
+
 void recvd(const char *resp, void *ctx) {
     bool power;
     uint8_t id;
@@ -1133,19 +1216,24 @@ void recvd(const char *resp, void *ctx) {
     char buf[10];
 
     if( resp ) {
-        if( rxv.decodeConfig(resp, power) ) {
-            snprintf(msg, sizeof(msg), "Got config while power is %s", power ? "on" : "off");
+        uint8_t changed[32];
+        if( rxv.decodeConfig(resp, power, changed) ) {
+            snprintf(msg, sizeof(msg), "Got config while power is %s (%u divergences in %u reconciles)",
+                power ? "on" : "off", rxv.divergences(), rxvcomm.reconciles());
             slog(msg);
+            snprintf(buf, sizeof(buf), "%u", rxv.divergences());
+            publish(MQTT_TOPIC "/status/Divergences", buf);
+#if STATE_JSON
+            publish_state();  // all values at once, corrections also go to their status topics
+#endif
             for( unsigned i=0; i<=0xff; i++ ) {
+                if( !(changed[i >> 3] & (1 << (i & 7))) ) continue;  // only publish corrections
                 const char *nm = rxv.report_name(i);
                 const char *val = rxv.report_value_string(i);
                 if( nm || val ) {
                     snprintf(msg, sizeof(msg), "Config x%02X: %s = %s", i, nm ? nm : "invalid", val ? val : "invalid");
                     slog(msg);
-                    if( nm ) {
-                        snprintf(msg, sizeof(msg), MQTT_TOPIC "/status/%s", nm);
-                        mqtt.publish(msg, val ? val : "");
-                    }
+                    if( nm ) status.changed(i);
                 }
             }
         }
@@ -1159,8 +1247,9 @@ void recvd(const char *resp, void *ctx) {
             snprintf(msg, sizeof(msg), "Report x%02X: %s = %s", id, name ? name : "invalid", value ? value : "invalid");
             slog(msg);
 
-            // Speaker A Relay also controls DSP mode
-            if( id == 0x2E ) {
+            // Speaker A Relay also controls DSP mode (unless the a-on or a-off scene does that)
+            // Sending from this callback is deferred until the report is handled
+            if( id == 0x2E && !speaker_scene() ) {
                 if( rxv.report_value(id) == 0x00 ) {
                     rxvcomm.send(rxv.command("DSP_2chStereo"));
                 }
@@ -1169,21 +1258,7 @@ void recvd(const char *resp, void *ctx) {
                 }
             }
 
-            // Double vol up/down: first changes by 0.5dB, further by 1dB
-            if( id == 0x26 && first_vol != 0 ) {
-                if( first_vol > 0 ) {
-                    rxvcomm.send(rxv.command("MainVolume_Up"));
-                }
-                else {
-                    rxvcomm.send(rxv.command("MainVolume_Down"));
-                }
-                first_vol = 0;
-            }
-            else if( name ) {
-                char topic[128];
-                snprintf(topic, sizeof(topic), MQTT_TOPIC "/status/%s", name);
-                publish(topic, value ? value : "");
-            }
+            if( name ) status.changed(id);
         }
         else if( rxv.decodeText(resp, id, text) ) {
             name = rxv.display_name(id);
@@ -1192,7 +1267,7 @@ void recvd(const char *resp, void *ctx) {
             if( name ) {
                 char topic[128];
                 snprintf(topic, sizeof(topic), MQTT_TOPIC "/status/%s", name);
-                mqtt.publish(topic, text);
+                publish(topic, text);
             }
         }
         else {
@@ -1201,14 +1276,21 @@ void recvd(const char *resp, void *ctx) {
         }
     }
     else {
+        // link is lost now: comm resyncs by itself, see link_changed()
         slog("TIMEOUT");
-        shouldReboot = millis();
-        if( shouldReboot == 0 ) shouldReboot--;
-        delayReboot = 60000;
     }
 }
 
 
+void link_changed(RxV1600Comm::link_t link, void *ctx) {
+    const char *name = RxV1600Comm::link_name(link);
+    snprintf(msg, sizeof(msg), "Link %s", name);
+    slog(msg, link == RxV1600Comm::LINK_HEALTHY ? LOG_NOTICE : LOG_WARNING);
+    publish(MQTT_TOPIC "/status/Link", name);
+}
+
+
+// Returns name of the scene to start on pin change
 const char *pin_changed(bool is_high) {
     static bool bt_has_powered_on = false;
 
@@ -1218,35 +1300,22 @@ const char *pin_changed(bool is_high) {
     };
 
     if( is_high ) {
-        const char *cmd = rxv.command("Input_Cbl-Sat");
-        if( !power ) {
-            rxvcomm.send(rxv.command("MainZonePower_On"));
-            bt_has_powered_on = true;
-            return cmd;
-        }
-        else {
-            bt_has_powered_on = false;
-            rxvcomm.send(cmd);
-        }
+        bt_has_powered_on = !power;
+        return "bt";
     }
-    else {
-        rxvcomm.send(rxv.command("Input_Dtv"));
-        if( bt_has_powered_on ) {
-            bt_has_powered_on = false;
-            return rxv.command("MainZonePower_Off");
-        }
+
+    if( bt_has_powered_on ) {
+        bt_has_powered_on = false;
+        return "tv-off";
     }
 
-    return NULL;
+    return "tv";
 }
 
 
 void handle_pin() {
     static const uint32_t debounce_ms = 10;
-    static const uint32_t powered_ms = 5000;
 
-    static const char *cmd = NULL;
-    static uint32_t power_at = 0;
     static uint32_t changed = 0;
     static bool was_high = false;
 
@@ -1258,23 +1327,23 @@ void handle_pin() {
         }
         else {
             if( now - changed > debounce_ms ) {
-                cmd = pin_changed(is_high);
-                if( cmd ) power_at = (now - 1) | 1;
+                scenes.start(pin_changed(is_high));
                 was_high = is_high;
             }
         }
     }
     else {
         changed = 0;
-        if( cmd && power_at && now - power_at > powered_ms ) {
-            rxvcomm.send(cmd);
-            power_at = 0;
-            cmd = NULL;
-        }
     }
 }
 
 
+void scene_done(const char *name, bool ok, void *ctx) {
+    snprintf(msg, sizeof(msg), "Scene %s %s", name, ok ? "done" : "failed");
+    slog(msg, ok ? LOG_INFO : LOG_WARNING);
+}
+
+
 void setup() {
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
@@ -1290,6 +1359,10 @@ void setup() {
     syslog.deviceHostname(HOSTNAME);
     syslog.appName("Joba1");
     syslog.defaultPriority(LOG_KERN);
+    health.log_queue = &log_queue;
+    log_queue.limit(LOG_INFO, LOG_INFO_MAX, 1000);
+    log_queue.limit(LOG_DEBUG, LOG_INFO_MAX, 1000);
+    xTaskCreatePinnedToCore(log_task, "log", 4096, NULL, tskIDLE_PRIORITY + 1, NULL, 0);  // loop() runs on core 1
 
     digitalWrite(LED_PIN, LOW);
 
@@ -1330,6 +1403,13 @@ void setup() {
 
     Serial1.begin(9600, SERIAL_8N1, 16, 17);
     rxvcomm.on_recv(recvd, NULL);
+    rxvcomm.on_link(link_changed, NULL);
+    rxvcomm.reconcile(RECONCILE_MS);
+    rxvcomm.capture(&capture);
+#if RXV1600_LOG_LEVEL > RXV1600_LOG_NONE
+    RxV1600Log::sink(log_line);
+#endif
+    scenes.on_done(scene_done, NULL);
     rxvcomm.send(rxv.command("Ready"));
     Serial.println("Sent Ready message");
 
@@ -1339,13 +1419,55 @@ void setup() {
 }
 
 
+// Count time between loop() calls into the loop histogram
+void measure_loop() {
+    static uint32_t prev_us = micros();
+
+    uint32_t now_us = micros();
+    uint32_t elapsed = now_us - prev_us;
+    health.loop_us[RxV1600Comm::bucket(elapsed)]++;
+    health.loop_us_sum += elapsed;
+    prev_us = now_us;
+}
+
+
+#ifdef RXV1600_PROFILE
+// Publish one handler profile per call every PROFILE_PUBLISH_MS, then restart profiling
+void publish_profile() {
+    static uint32_t prev_publish = 0;
+    static unsigned slot = 0;
+
+    if (slot == 0 && millis() - prev_publish < PROFILE_PUBLISH_MS) return;
+
+    char topic[80];
+    snprintf(topic, sizeof(topic), MQTT_TOPIC "/status/Profile/%s", profiler.name(slot));
+    profiler.json(slot, msg, sizeof(msg));
+    publish(topic, msg);
+
+    if (++slot == profiler.slots()) {
+        slot = 0;
+        prev_publish = millis();
+        profiler.reset();
+    }
+}
+#endif
+
+
 void loop() {
-    rxvcomm.handle();
-    check_ntptime();
-    handle_pin();
-    handle_wifi();
-    handle_reboot();
+    measure_loop();
+    RXV_PROFILE(profiler, P_COMM, rxvcomm.handle());
+    RXV_PROFILE(profiler, P_VOLUME, volume.handle());
+    RXV_PROFILE(profiler, P_SCENES, scenes.handle());
+    RXV_PROFILE(profiler, P_BATCH, batch.handle());
+    RXV_PROFILE(profiler, P_STATUS, status.handle());
+    RXV_PROFILE(profiler, P_NTP, check_ntptime());
+    RXV_PROFILE(profiler, P_PIN, handle_pin());
+    RXV_PROFILE(profiler, P_WIFI, handle_wifi());
+    RXV_PROFILE(profiler, P_REBOOT, handle_reboot());
 
     // MQTT handling (publish commands from web and publish status updates from receiver)
-    handle_mqtt(check_ntptime());
+    RXV_PROFILE(profiler, P_MQTT, handle_mqtt(check_ntptime()));
+#ifdef RXV1600_PROFILE
+    publish_profile();
+#endif
 }
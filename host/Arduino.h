@@ -0,0 +1,18 @@
+#pragma once
+
+// Minimal Arduino core for building the library on a host
+
+#include <Stream.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/// @brief milliseconds since program start, wraps like on Arduino
+uint32_t millis();
+
+/// @brief microseconds since program start, wraps like on Arduino
+uint32_t micros();
@@ -0,0 +1,37 @@
+#pragma once
+
+// Minimal Arduino Print and Stream for building the library on a host
+// Only what the library uses: read available chars and print command strings.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+class Print {
+    public:
+
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t ch) = 0;
+
+    virtual size_t write(const uint8_t *buf, size_t size) {
+        size_t n = 0;
+        while( size-- && write(*(buf++)) ) n++;
+        return n;
+    }
+
+    size_t print(const char *str) {
+        return write((const uint8_t *)str, strlen(str));
+    }
+};
+
+
+class Stream : public Print {
+    public:
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
@@ -0,0 +1,19 @@
+#include <Arduino.h>
+
+#include <chrono>
+
+
+uint32_t millis() {
+    static const auto start = std::chrono::steady_clock::now();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+
+uint32_t micros() {
+    static const auto start = std::chrono::steady_clock::now();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
@@ -0,0 +1,400 @@
+#include "rxv1600emu.h"
+
+#include <Arduino.h>
+#include <ctype.h>
+
+
+const uint32_t RxV1600Emu::BYTE_US = 1042;  // 10 bits at 9600 baud
+const uint32_t RxV1600Emu::RESPONSE_MS = 10;
+const uint32_t RxV1600Emu::POWER_ON_MS = 3000;
+
+
+// Power report values by zones on (bit 0 main, bit 1 zone 2, bit 2 zone 3)
+static const uint8_t POWER[8] = { 0, 2, 6, 4, 7, 5, 3, 1 };
+
+// Config response fields after DT0-DT6 in the order RxV1600::decodeConfig() reads them
+// Positive: report id, negative: special fields
+enum { F_SKIP = -1, F_MULTI = -2, F_STRAIGHT = -3, F_DECODER = -4 };
+static const struct {
+    int16_t id;     // report id or special field
+    uint8_t count;  // number of hex chars
+} CONFIG[] = {
+    { 0x00, 1 }, { 0x20, 1 }, { 0x21, 1 },  // power off config ends here
+    { F_MULTI, 1 }, { 0x22, 1 }, { 0x23, 1 }, { 0x24, 1 }, { 0x25, 1 },
+    { 0x26, 2 }, { 0x27, 2 }, { 0x28, 2 }, { F_STRAIGHT, 1 },
+    { 0x2D, 1 }, { 0x2B, 1 }, { 0x2C, 1 }, { 0x29, 1 }, { 0x2A, 1 }, { 0x8B, 2 },
+    { 0x2E, 1 }, { 0x2F, 1 }, { 0x10, 1 }, { 0x11, 1 }, { 0x12, 1 }, { 0x13, 1 }, { 0x14, 1 },
+    { 0x34, 1 }, { 0x35, 1 }, { 0x15, 1 }, { F_SKIP, 1 }, { F_DECODER, 1 }, { F_SKIP, 2 },
+    { 0x16, 1 }, { F_SKIP, 2 }, { 0x3D, 1 }, { F_SKIP, 83-47 },
+    { 0x5F, 1 }, { 0x60, 1 }, { 0x61, 1 }, { F_SKIP, 106-86 }, { 0xA7, 1 }, { F_SKIP, 119-107 },
+    { 0x6E, 1 }, { F_SKIP, 123-120 }, { 0xB2, 1 }, { 0xB3, 1 }, { F_SKIP, 1 }, { 0x8C, 1 },
+    { 0xA0, 1 }, { 0xA1, 1 }, { 0xA2, 2 }, { 0xB9, 1 }, { 0x7B, 1 }, { F_SKIP, 1 }, { 0xBB, 1 },
+    { F_SKIP, 139-135 }, { 0x4B, 1 }, { 0x4C, 1 }, { 0x4D, 1 }, { 0x4E, 1 }, { 0xA8, 1 }, { 0xBD, 1 }
+};
+static const size_t CONFIG_OFF = 3;  // fields of a power off config
+
+
+// lower case letters and digits only, e.g. "Cbl/Sat" and "Cbl-Sat" both are "cblsat"
+static std::string normalized( const char *str ) {
+    std::string norm;
+    for( ; *str; str++ ) {
+        if( isalnum((unsigned char)*str) ) norm += (char)tolower((unsigned char)*str);
+    }
+    return norm;
+}
+
+
+static void hex( std::string &str, unsigned value, unsigned count ) {
+    static const char digits[] = "0123456789ABCDEF";
+    while( count-- ) {
+        str += digits[(value >> (4 * count)) & 0xF];
+    }
+}
+
+
+static int unhex( const char *str, unsigned count ) {
+    int value = 0;
+    while( count-- ) {
+        char ch = *(str++);
+        if( ch >= '0' && ch <= '9' ) value = value << 4 | (ch - '0');
+        else if( ch >= 'A' && ch <= 'F' ) value = value << 4 | (ch - 'A' + 10);
+        else return -1;
+    }
+    return value;
+}
+
+
+RxV1600Emu::RxV1600Emu(RxV1600Clock::millis_t clock) : _millis(clock ? clock : RxV1600Clock::millis),
+        _elapsed_ms(0), _tx_end(0), _ready_at(0), _response_ms(RESPONSE_MS), _power_on_ms(POWER_ON_MS),
+        _loss_pct(0), _corrupt_pct(0), _random(1), _commands(0), _responses(0) {
+    _last_ms = _millis();
+    memset(_state, 0, sizeof(_state));
+    _state[0x20] = POWER[1];  // main zone on
+    _state[0x21] = 0x05;      // Dvd
+    _state[0x26] = 0xC7;      // 0 dB
+    _state[0x27] = 0x27;      // -80 dB
+    _state[0xA2] = 0x27;
+    _state[0x28] = 0x05;      // Vienna
+    _state[0x2E] = 0x01;      // Speaker A on
+}
+
+
+uint8_t RxV1600Emu::get(uint8_t id) const {
+    return _state[id];
+}
+
+
+void RxV1600Emu::set(uint8_t id, uint8_t value) {
+    _state[id] = value;
+}
+
+
+void RxV1600Emu::change(uint8_t id, uint8_t value, RxV1600::origin_t origin) {
+    _state[id] = value;
+    report(id, now_us(), '0' + origin);
+}
+
+
+void RxV1600Emu::delays(uint32_t response_ms, uint32_t power_on_ms) {
+    _response_ms = response_ms;
+    _power_on_ms = power_on_ms;
+}
+
+
+void RxV1600Emu::errors(unsigned loss_pct, unsigned corrupt_pct, uint32_t seed) {
+    _loss_pct = loss_pct;
+    _corrupt_pct = corrupt_pct;
+    _random = seed ? seed : 1;
+}
+
+
+uint32_t RxV1600Emu::commands() const {
+    return _commands;
+}
+
+
+uint32_t RxV1600Emu::responses() const {
+    return _responses;
+}
+
+
+uint64_t RxV1600Emu::now_us() {
+    uint32_t ms = _millis();
+    _elapsed_ms += (uint32_t)(ms - _last_ms);
+    _last_ms = ms;
+    return _elapsed_ms * 1000;
+}
+
+
+uint32_t RxV1600Emu::random() {
+    // xorshift32
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random;
+}
+
+
+void RxV1600Emu::handle_time( uint64_t now ) {
+    if( _ready_at && now >= _ready_at ) {
+        _state[0x00] = 0;  // System Ok
+        report(0x00, _ready_at);
+        _ready_at = 0;
+    }
+}
+
+
+int RxV1600Emu::available() {
+    uint64_t now = now_us();
+    handle_time(now);
+
+    int count = 0;
+    for( auto &out : _out ) {
+        if( out.at > now ) break;
+        count++;
+    }
+    return count;
+}
+
+
+int RxV1600Emu::read() {
+    int ch = peek();
+    if( ch >= 0 ) _out.pop_front();
+    return ch;
+}
+
+
+int RxV1600Emu::peek() {
+    uint64_t now = now_us();
+    handle_time(now);
+
+    if( _out.empty() || _out.front().at > now ) return -1;
+    return (uint8_t)_out.front().ch;
+}
+
+
+size_t RxV1600Emu::write(uint8_t ch) {
+    if( _cmd.empty() && ch != *STX && ch != *DC1 && ch != *DC3 ) return 1;  // not a command start
+
+    _cmd += (char)ch;
+    if( ch == *ETX || _cmd.size() > 7 ) {
+        // command is complete once its last char is received
+        uint64_t now = now_us();
+        handle_time(now);
+        command(now + _cmd.size() * BYTE_US + _response_ms * 1000);
+        _cmd.clear();
+    }
+    return 1;
+}
+
+
+void RxV1600Emu::command( uint64_t at ) {
+    _commands++;
+
+    if( _cmd == DC1 "000" ETX ) {
+        config(at);
+        return;
+    }
+
+    if( _cmd.size() != 7 || _cmd[0] != *STX || _cmd[6] != *ETX ) return;  // ignore garbage
+
+    if( _state[0x00] == 1 ) {
+        report(0x00, at);  // Busy
+        return;
+    }
+
+    if( _cmd[1] == '2' ) {
+        int cmd = unhex(&_cmd[2], 2);
+        int data = unhex(&_cmd[4], 2);
+        if( cmd >= 0 && data >= 0 ) system(cmd, data, at);
+        return;
+    }
+
+    for( auto cmd = RxV1600::begin(); cmd != RxV1600::end(); cmd++ ) {
+        if( _cmd == cmd->second ) {
+            operation(cmd->first, at);
+            return;
+        }
+    }
+
+    report(0x00, at);  // unknown operation: just acknowledge
+}
+
+
+void RxV1600Emu::operation( const char *name, uint64_t at ) {
+    // report ids of command name prefixes that differ from the report name
+    static const struct { const char *prefix; uint8_t id; } ALIASES[] = {
+        { "Mute", 0x23 }, { "DSP", 0x28 }, { "NightListening", 0x8B }
+    };
+    static const struct { const char *prefix; uint8_t id; } VOLUMES[] = {
+        { "MainVolume", 0x26 }, { "Zone2Volume", 0x27 }, { "Zone3Volume", 0xA2 }
+    };
+    static const struct { const char *prefix; uint8_t zones; } POWERS[] = {
+        { "AllZonePower", 7 }, { "MainZonePower", 1 }, { "Zone2ZonePower", 2 }, { "Zone3ZonePower", 4 }
+    };
+
+    const char *sep = strchr(name, '_');
+    std::string prefix(name, sep ? sep - name : strlen(name));
+    std::string suffix = sep ? normalized(sep + 1) : "";
+
+    for( auto &vol : VOLUMES ) {
+        if( prefix == vol.prefix ) {
+            if( _state[vol.id] || suffix == "up" ) {
+                int value = _state[vol.id] ? _state[vol.id] : 0x26;  // up from Infinite starts at -80 dB
+                value += (suffix == "up") ? 1 : -1;
+                _state[vol.id] = (value < 0x27) ? 0x27 : (value > 0xE8) ? 0xE8 : value;
+            }
+            report(vol.id, at);
+            return;
+        }
+    }
+
+    for( auto &pwr : POWERS ) {
+        if( prefix == pwr.prefix ) {
+            uint8_t zones = 0;
+            while( zones < 8 && POWER[zones] != _state[0x20] ) zones++;
+            zones = (suffix == "on") ? (zones | pwr.zones) : (zones & ~pwr.zones);
+            power(zones & 7, at);
+            return;
+        }
+    }
+
+    int id = -1;
+    for( auto &alias : ALIASES ) {
+        if( prefix == alias.prefix ) id = alias.id;
+    }
+    for( unsigned i = 0; id < 0 && i <= 0xFF; i++ ) {
+        const char *report = RxV1600::report_name(i);
+        if( report && prefix == report ) id = i;
+    }
+
+    if( id >= 0 ) {
+        // exact match of the value string first, then prefix, e.g. "Cinema" for "Cinema Level Low"
+        for( int exact = 1; exact >= 0; exact-- ) {
+            for( unsigned value = 0; value <= 0xFF; value++ ) {
+                const char *str = RxV1600::value_string(id, value);
+                if( !str ) continue;
+                std::string norm = normalized(str);
+                if( exact ? norm == suffix : norm.compare(0, suffix.size(), suffix) == 0 ) {
+                    _state[id] = value;
+                    report(id, at);
+                    return;
+                }
+            }
+        }
+    }
+
+    report(0x00, at);  // no state change known: just acknowledge
+}
+
+
+void RxV1600Emu::system( uint8_t cmd, uint8_t data, uint64_t at ) {
+    switch( cmd ) {
+        case 0x00: case 0x01: case 0x10:  // report settings, osd
+            report(0x00, at);
+            break;
+        case 0x20: case 0x2F:  // text requests
+            text(data, at);
+            break;
+        case 0x26:  // dimmer
+            _state[0x61] = data & 0x0F;
+            report(0x61, at);
+            break;
+        case 0x30: case 0x31: case 0x34:  // volume set
+            cmd = (cmd == 0x30) ? 0x26 : (cmd == 0x31) ? 0x27 : 0xA2;
+            _state[cmd] = data;
+            report(cmd, at);
+            break;
+        default:  // rcmd is the report id
+            _state[cmd] = data;
+            report(cmd, at);
+            break;
+    }
+}
+
+
+void RxV1600Emu::power( uint8_t zones, uint64_t at ) {
+    bool was_off = _state[0x20] == POWER[0];
+
+    _state[0x20] = POWER[zones];
+    if( was_off && zones ) {
+        // double response: busy while powering on, Ok later
+        _state[0x00] = 1;
+        report(0x00, at);
+        _ready_at = at + _power_on_ms * 1000;
+    }
+    report(0x20, at);
+}
+
+
+void RxV1600Emu::config( uint64_t at ) {
+    bool on = _state[0x20] != POWER[0];
+    std::string data = "0000000";  // DT0-DT6
+
+    for( size_t f = 0; f < (on ? sizeof(CONFIG) / sizeof(*CONFIG) : CONFIG_OFF); f++ ) {
+        unsigned value;
+        switch( CONFIG[f].id ) {
+            case F_SKIP:     value = 0; break;
+            case F_MULTI:    value = (_state[0x21] & 0x10) ? 1 : 0; break;
+            case F_STRAIGHT: value = (_state[0x28] & 0x80) ? 0 : 1; break;
+            case F_DECODER:  value = _state[0x22] >> 4; break;
+            case 0x21:       value = _state[0x21] & 0x0F; break;
+            case 0x22:       value = _state[0x22] & 0x0F; break;
+            case 0x28:       value = _state[0x28] & 0x7F; break;
+            default:         value = _state[CONFIG[f].id]; break;
+        }
+        hex(data, value, CONFIG[f].count);
+    }
+
+    std::string frame = DC2 "R0161" "0";  // model id and version
+    hex(frame, data.size(), 2);
+    frame += data;
+
+    unsigned sum = 0;
+    for( size_t i = 1; i < frame.size(); i++ ) sum += (uint8_t)frame[i];
+    hex(frame, sum & 0xFF, 2);
+
+    emit(frame + ETX, at);
+}
+
+
+void RxV1600Emu::text( uint8_t id, uint64_t at ) {
+    char buf[16];
+    const char *str = NULL;
+
+    if( id == 0x01 ) str = RxV1600::value_string(0x26, _state[0x26]);
+    if( id == 0x02 ) str = RxV1600::value_string(0x27, _state[0x27]);
+    if( id == 0x05 ) str = RxV1600::value_string(0xA2, _state[0xA2]);
+    snprintf(buf, sizeof(buf), "%8.8s", str ? str : "RX-V1600");
+
+    std::string frame = DC1;
+    hex(frame, id, 2);
+    emit(frame + buf + ETX, at);
+}
+
+
+void RxV1600Emu::report( uint8_t id, uint64_t at, char origin ) {
+    std::string frame = STX;
+    frame += origin;
+    frame += '0';  // guard
+    hex(frame, id, 2);
+    hex(frame, _state[id], 2);
+    emit(frame + ETX, at);
+}
+
+
+void RxV1600Emu::emit( std::string frame, uint64_t at ) {
+    _responses++;
+
+    if( _loss_pct && random() % 100 < _loss_pct ) return;
+    if( _corrupt_pct && random() % 100 < _corrupt_pct ) {
+        frame[1 + random() % (frame.size() - 2)] = 'Z';  // never a valid hex char
+    }
+
+    uint64_t start = (at > _tx_end) ? at : _tx_end;
+    for( char ch : frame ) {
+        start += BYTE_US;
+        _out.push_back({ start, ch });
+    }
+    _tx_end = start;
+}
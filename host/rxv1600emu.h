@@ -0,0 +1,108 @@
+#pragma once
+
+// Emulator of a Yamaha RX-V1600 AV Receiver serial port for host tests, benchmarks and tools
+// It is the Stream RxV1600Comm talks to: written commands change a virtual receiver
+// state and queue responses, which become readable char by char at 9600 baud.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600.h>
+
+#include <deque>
+#include <string>
+
+
+/// Class to emulate the RS232 protocol of an RX-V1600
+/// Commands are recognized with the command table of RxV1600, report names and values
+/// are matched with its report and value tables, so the emulator knows what the library knows.
+///   - Ready is answered with a config response built from the virtual state
+///   - operation and system commands are answered with the report of the changed value
+///   - powering on from all zones off reports System Busy and Power, then System Ok later
+///   - commands sent while busy are only answered with a System Busy report
+/// Responses can be dropped or garbled at random to test error handling.
+class RxV1600Emu : public Stream {
+    public:
+
+    static const uint32_t BYTE_US;      // transfer time of one char at 9600 baud 8N1
+    static const uint32_t RESPONSE_MS;  // default delay between command and response
+    static const uint32_t POWER_ON_MS;  // default time the System is busy after power on
+
+    /// @brief emulate an RX-V1600 with main zone on and 0 dB main volume
+    /// @param clock time source, NULL for millis(). Use the same clock as RxV1600Comm
+    RxV1600Emu(RxV1600Clock::millis_t clock = NULL);
+
+    /// @brief get a value of the virtual state
+    /// @param id report id
+    /// @return current value
+    uint8_t get(uint8_t id) const;
+
+    /// @brief change a value of the virtual state without a report
+    /// @param id report id
+    /// @param value new value
+    void set(uint8_t id, uint8_t value);
+
+    /// @brief change a value of the virtual state and report it, like a change by remote control
+    /// @param id report id
+    /// @param value new value
+    /// @param origin origin reported with the change
+    void change(uint8_t id, uint8_t value, RxV1600::origin_t origin = RxV1600::O_IR);
+
+    /// @brief set delays of the virtual receiver
+    /// @param response_ms time between end of a command and start of its response
+    /// @param power_on_ms time the System is busy after power on
+    void delays(uint32_t response_ms, uint32_t power_on_ms);
+
+    /// @brief set error rates of the responses
+    /// @param loss_pct percentage of response frames that are dropped
+    /// @param corrupt_pct percentage of response frames with one garbled char
+    /// @param seed start value of the random generator, same seed gives same errors
+    void errors(unsigned loss_pct, unsigned corrupt_pct, uint32_t seed = 1);
+
+    /// @brief get number of complete commands received
+    /// @return number of commands
+    uint32_t commands() const;
+
+    /// @brief get number of response frames queued, including dropped and garbled ones
+    /// @return number of responses
+    uint32_t responses() const;
+
+    // Stream interface as seen by RxV1600Comm
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t ch) override;
+
+    private:
+
+    uint64_t now_us();  // emulator time, does not wrap
+    void handle_time( uint64_t now );  // finish power on
+    void command( uint64_t at );  // handle the command in _cmd
+    void operation( const char *name, uint64_t at );
+    void system( uint8_t cmd, uint8_t data, uint64_t at );
+    void config( uint64_t at );
+    void text( uint8_t id, uint64_t at );
+    void power( uint8_t zones, uint64_t at );
+    void report( uint8_t id, uint64_t at, char origin = '0' );
+    void emit( std::string frame, uint64_t at );  // queue a response starting at time at
+    uint32_t random();
+
+    typedef struct out_char {
+        uint64_t at;  // time the char is completely received by RxV1600Comm
+        char ch;
+    } out_char_t;
+
+    RxV1600Clock::millis_t _millis;
+    uint32_t _last_ms;        // last clock value, to extend time beyond 32 bits
+    uint64_t _elapsed_ms;     // time since construction
+    uint8_t _state[256];      // virtual receiver state
+    std::string _cmd;         // partially received command
+    std::deque<out_char_t> _out;  // queued response chars
+    uint64_t _tx_end;         // time the last queued char is completely sent
+    uint64_t _ready_at;       // time power on finishes or 0
+    uint32_t _response_ms;
+    uint32_t _power_on_ms;
+    unsigned _loss_pct;
+    unsigned _corrupt_pct;
+    uint32_t _random;         // state of random generator
+    uint32_t _commands;
+    uint32_t _responses;
+};
@@ -0,0 +1,106 @@
+#include "serialstream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+
+SerialStream::SerialStream() : _fd(-1), _pos(0) {
+}
+
+
+SerialStream::~SerialStream() {
+    close();
+}
+
+
+bool SerialStream::open(const char *device) {
+    close();
+
+    _fd = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if( _fd < 0 ) return false;
+
+    struct termios tio;
+    if( tcgetattr(_fd, &tio) != 0 ) {
+        close();
+        return false;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B9600);
+    cfsetospeed(&tio, B9600);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+    if( tcsetattr(_fd, TCSANOW, &tio) != 0 ) {
+        close();
+        return false;
+    }
+
+    _in.clear();
+    _pos = 0;
+    return true;
+}
+
+
+void SerialStream::close() {
+    if( _fd >= 0 ) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+
+int SerialStream::fd() const {
+    return _fd;
+}
+
+
+bool SerialStream::fill() {
+    if( _fd < 0 ) return false;
+
+    if( _pos == _in.size() ) {
+        _in.clear();
+        _pos = 0;
+    }
+
+    char buf[256];
+    while( true ) {
+        ssize_t len = ::read(_fd, buf, sizeof(buf));
+        if( len > 0 ) {
+            _in.append(buf, len);
+        }
+        else if( len < 0 && errno == EINTR ) {
+            continue;
+        }
+        else {
+            return len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+}
+
+
+int SerialStream::available() {
+    return (int)(_in.size() - _pos);
+}
+
+
+int SerialStream::read() {
+    return (_pos < _in.size()) ? (uint8_t)_in[_pos++] : -1;
+}
+
+
+int SerialStream::peek() {
+    return (_pos < _in.size()) ? (uint8_t)_in[_pos] : -1;
+}
+
+
+size_t SerialStream::write(uint8_t ch) {
+    return write(&ch, 1);
+}
+
+
+size_t SerialStream::write(const uint8_t *buf, size_t size) {
+    // commands are a few chars only, the kernel buffer takes them at once
+    ssize_t len = (_fd < 0) ? -1 : ::write(_fd, buf, size);
+    return (len < 0) ? 0 : (size_t)len;
+}
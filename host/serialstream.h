@@ -0,0 +1,47 @@
+#pragma once
+
+// Non-blocking Stream on a Linux serial port (or pseudo terminal) for host tools
+
+#include <Stream.h>
+
+#include <string>
+
+
+/// Class to use a termios serial port as Stream for RxV1600Comm
+/// The port is opened non-blocking with 9600 baud 8N1 raw.
+/// Received chars are buffered by fill(), so an event loop can call it when the fd is readable.
+class SerialStream : public Stream {
+    public:
+
+    SerialStream();
+    ~SerialStream();
+
+    /// @brief open and configure a serial port
+    /// @param device path of the port, e.g. /dev/ttyUSB0
+    /// @return true on success
+    bool open(const char *device);
+
+    /// @brief close the port
+    void close();
+
+    /// @brief get file descriptor, e.g. for epoll
+    /// @return fd or -1 if not open
+    int fd() const;
+
+    /// @brief read all chars the port has available into the buffer
+    /// @return false if the port failed or was closed by the other end
+    bool fill();
+
+    // Stream interface
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t ch) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+
+    private:
+
+    int _fd;
+    std::string _in;  // received chars not yet read
+    size_t _pos;      // next char to read from _in
+};
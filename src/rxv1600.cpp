@@ -1,262 +1,43 @@
 #include <rxv1600.h>
+#include <rxv1600tables.h>
 
 #include <map>
+#include <stdio.h>
 #include <string.h>
 
 
+// map entries of the tables
+#define RXV_ENTRY(key, value, ...) { key, value },
+
 static RxV1600::cmds_t CMDS = {
-    // Init communication and request current configuration
-    { "Ready",                 DC1 "000" ETX },
-
-    // Reset config to factory defaults
-    { "ResetConfig",           DC3 DEL DEL DEL ETX },
-
-    // Operation commands (same as IR commands)
-    { "MainVolume_Up",         STX "07A1A" ETX },
-    { "MainVolume_Down",       STX "07A1B" ETX },
-
-    { "Mute_On",               STX "07EA2" ETX },
-    { "Mute_20dB",             STX "07EDF" ETX },
-    { "Mute_Off",              STX "07EA3" ETX },
-
-    { "Input_Phono",           STX "07A14" ETX },
-    { "Input_Cd",              STX "07A15" ETX },
-    { "Input_Tuner",           STX "07A16" ETX },
-    { "Input_CD-R",            STX "07A19" ETX },
-    { "Input_MD-Tape",         STX "07A18" ETX },
-    { "Input_Dvd",             STX "07AC1" ETX },
-    { "Input_Dtv",             STX "07A54" ETX },
-    { "Input_Cbl-Sat",         STX "07AC0" ETX },
-    { "Input_Vcr1",            STX "07A0F" ETX },
-    { "Input_Dvr-Vcr2",        STX "07A13" ETX },
-    { "Input_V-Aux",           STX "07A55" ETX },
-
-    { "Zone2Volume_Up",        STX "07ADA" ETX },
-    { "Zone2Volume_Down",      STX "07ADB" ETX },
-
-    { "Zone2Mute_On",          STX "07EA0" ETX },
-    { "Zone2Mute_Off",         STX "07EA1" ETX },
-
-    { "Zone2Input_Phono",      STX "07AD0" ETX },
-    { "Zone2Input_Cd",         STX "07AD1" ETX },
-    { "Zone2Input_Tuner",      STX "07AD2" ETX },
-    { "Zone2Input_CD-R",       STX "07AD4" ETX },
-    { "Zone2Input_MD-Tape",    STX "07AD3" ETX },
-    { "Zone2Input_Dvd",        STX "07ACD" ETX },
-    { "Zone2Input_Dtv",        STX "07AD9" ETX },
-    { "Zone2Input_Cbl-Sat",    STX "07ACC" ETX },
-    { "Zone2Input_Vcr1",       STX "07AD6" ETX },
-    { "Zone2Input_Dvr-Vcr2",   STX "07AD7" ETX },
-    { "Zone2Input_V-Aux",      STX "07AD8" ETX },
-
-    { "AllZonePower_On",       STX "07A1D" ETX },
-    { "AllZonePower_Off",      STX "07A1E" ETX },
-    
-    { "MainZonePower_On",      STX "07E7E" ETX },
-    { "MainZonePower_Off",     STX "07E7F" ETX },
-    
-    { "Zone2ZonePower_On",     STX "07EBA" ETX },
-    { "Zone2ZonePower_Off",    STX "07EBB" ETX },
-    
-    { "Zone3ZonePower_On",     STX "07AED" ETX },
-    { "Zone3ZonePower_Off",    STX "07AEE" ETX },
-    
-    { "Zone3Mute_On",          STX "07E26" ETX },
-    { "Zone3Mute_Off",         STX "07E66" ETX },
-
-    { "Zone3Volume_Up",        STX "07AFD" ETX },
-    { "Zone3Volume_Down",      STX "07AFE" ETX },
-
-    { "Zone3Input_Phono",      STX "07AF1" ETX },
-    { "Zone3Input_Cd",         STX "07AF2" ETX },
-    { "Zone3Input_Tuner",      STX "07AF3" ETX },
-    { "Zone3Input_CD-R",       STX "07AF5" ETX },
-    { "Zone3Input_MD-Tape",    STX "07AF4" ETX },
-    { "Zone3Input_Dvd",        STX "07AFC" ETX },
-    { "Zone3Input_Dtv",        STX "07AF6" ETX },
-    { "Zone3Input_Cbl-Sat",    STX "07AF7" ETX },
-    { "Zone3Input_Vcr1",       STX "07AF9" ETX },
-    { "Zone3Input_Dvr-Vcr2",   STX "07AFA" ETX },
-    { "Zone3Input_V-Aux",      STX "07AF0" ETX },
-
-    { "NightListening_Off",    STX "07E9C" ETX },
-    { "NightListening_Cinema", STX "07E9B" ETX },
-    { "NightListening_Music",  STX "07ECF" ETX },
-
-    // probably mutually exclusive
-    { "Effect",                STX "07E27" ETX },
-    { "Straight",              STX "07EE0" ETX },
-
-    { "DSP_Vienna",            STX "07EE5" ETX },
-    { "DSP_TheBottomLine",     STX "07EEC" ETX },
-    { "DSP_TheRoxyTheatre",    STX "07EED" ETX },
-    { "DSP_Disco",             STX "07EF0" ETX },
-    { "DSP_Game",              STX "07EF2" ETX },
-    { "DSP_7chStereo",         STX "07EFF" ETX },
-    { "DSP_2chStereo",         STX "07EC0" ETX },
-    { "DSP_Pop-Rock",          STX "07EF3" ETX },
-    { "DSP_MonoMovie",         STX "07EF7" ETX },
-    { "DSP_TvSports",          STX "07EF8" ETX },
-    { "DSP_Spectacle",         STX "07EF9" ETX },
-    { "DSP_SciFi",             STX "07EFA" ETX },
-    { "DSP_Adventure",         STX "07EFB" ETX },
-    { "DSP_General",           STX "07EFC" ETX },
-    { "DSP_Standard",          STX "07EFD" ETX },
-    { "DSP_Enhanced",          STX "07EFE" ETX },
-    { "DSP_ThxCinema",         STX "07EC2" ETX },
-    { "DSP_ThxMusic",          STX "07EC3" ETX },
-    { "DSP_ThxGame",           STX "07EC8" ETX },
-
-    { "SpeakerRelayA_On",      STX "07EAB" ETX },
-    { "SpeakerRelayA_Off",     STX "07EAC" ETX },
-
-    { "SpeakerRelayB_On",      STX "07EAD" ETX },
-    { "SpeakerRelayB_Off",     STX "07EAE" ETX },
-
-    { "2ChDecoder_PliixMovie", STX "07E67" ETX },
-    { "2ChDecoder_PliixMusic", STX "07E68" ETX },
-    { "2ChDecoder_Neo6Cinema", STX "07E69" ETX },
-    { "2ChDecoder_Neo6Music",  STX "07E6A" ETX },
-    { "2ChDecoder_PliixGame",  STX "07EC7" ETX },
-    { "2ChDecoder_ProLogic",   STX "07EC9" ETX },
-
-    { "Zone2Tone_BassUp",      STX "07A73" ETX },
-    { "Zone2Tone_BassDown",    STX "07A74" ETX },
-    { "Zone2Tone_TrebleUp",    STX "07A75" ETX },
-    { "Zone2Tone_TrebleDown",  STX "07A76" ETX },
-
-    { "Zone3Tone_BassUp",      STX "07A77" ETX },
-    { "Zone3Tone_BassDown",    STX "07A78" ETX },
-    { "Zone3Tone_TrebleUp",    STX "07A79" ETX },
-    { "Zone3Tone_TrebleDown",  STX "07A7A" ETX },
-
-    // System commands
-    { "ReportCommandCode_Enable",  STX "20000" ETX },
-    { "ReportCommandCode_Disable", STX "20001" ETX },
-
-    { "ReportCommandDelay_0",      STX "20100" ETX },
-    { "ReportCommandDelay_50",     STX "20101" ETX },
-    { "ReportCommandDelay_100",    STX "20102" ETX },
-    { "ReportCommandDelay_150",    STX "20103" ETX },
-    { "ReportCommandDelay_200",    STX "20104" ETX },
-    { "ReportCommandDelay_250",    STX "20105" ETX },
-    { "ReportCommandDelay_300",    STX "20106" ETX },
-    { "ReportCommandDelay_350",    STX "20107" ETX },
-    { "ReportCommandDelay_400",    STX "20108" ETX },
-
-    { "OsdMessageStart",           STX "21000" ETX },
-    { "TuningFrequencyText",       STX "22000" ETX },
-    { "MainVolumeText",            STX "22001" ETX },
-    { "Zone2VolumeText",           STX "22002" ETX },
-    { "MainInputText",             STX "22003" ETX },
-    { "Zone2InputText",            STX "22004" ETX },
-    { "Zone3VolumeText",           STX "22005" ETX },
-    { "Zone3InputText",            STX "22006" ETX },
-    { "FirmwareVersion",           STX "22F00" ETX },
-
-    { "Dimmer_4",                  STX "22610" ETX },
-    { "Dimmer_3",                  STX "22611" ETX },
-    { "Dimmer_2",                  STX "22612" ETX },
-    { "Dimmer_1",                  STX "22613" ETX },
-    { "Dimmer_Off",                STX "22614" ETX },
-
-    { "MultiChannel_6Ch",          STX "27B00" ETX },
-    { "MultiChannel_8ChTuner",     STX "27B01" ETX },
-    { "MultiChannel_8ChCd",        STX "27B02" ETX },
-    { "MultiChannel_8ChCd-R",      STX "27B03" ETX },
-    { "MultiChannel_8ChMd-Tape",   STX "27B04" ETX },
-    { "MultiChannel_8ChDvd",       STX "27B05" ETX },
-    { "MultiChannel_8ChDtv",       STX "27B06" ETX },
-    { "MultiChannel_8ChCblSat",    STX "27B07" ETX },
-    { "MultiChannel_8ChVcr1",      STX "27B09" ETX },
-    { "MultiChannel_8ChDvr-Vcr2",  STX "27B0A" ETX },
-    { "MultiChannel_8ChV-Aux",     STX "27B0C" ETX },
-
-    { "NightMode_Off",             STX "28B00" ETX },
-    { "NightMode_CinemaLow",       STX "28B10" ETX },
-    { "NightMode_CinemaMid",       STX "28B11" ETX },
-    { "NightMode_CinemaHigh",      STX "28B12" ETX },
-    { "NightMode_MusicLow",        STX "28B20" ETX },
-    { "NightMode_MusicMid",        STX "28B21" ETX },
-    { "NightMode_MusicHigh",       STX "28B22" ETX },
-
-    { "WakeOnRs232C_Off",          STX "2BD00" ETX },
-    { "WakeOnRs232C_On",           STX "2BD01" ETX }
+    RXV1600_COMMANDS(RXV_ENTRY, RXV_ENTRY)
 };
 
 
 static const std::map<const char *, const char *, RxV1600::key1_less_key2_t> FMTS = {
-    // System commands with values
-    { "MainVolumeSet",             STX "230%02X" ETX },
-    { "Zone2VolumeSet",            STX "231%02X" ETX },
-    { "Zone3VolumeSet",            STX "234%02X" ETX }
+    RXV1600_VALUE_COMMANDS(RXV_ENTRY, RXV_ENTRY)
 };
 
 
 static const std::map<uint8_t, const char *> RPTS = {
-    { 0x00, "System" },
-    { 0x01, "Warning" },
-
-    { 0x10, "Playback" },
-    { 0x11, "Fs" },  // sampling frequency
-    { 0x12, "ExEs" },
-    { 0x13, "ThrBypass" },
-    { 0x14, "Red-Dts" },
-    { 0x15, "TunerTuned" },
-    { 0x16, "Dts96-24" },
-
-    { 0x20, "Power" },
-    { 0x21, "Input" },
-    { 0x22, "AudioMode" },
-    { 0x23, "AudioMute" },
-    { 0x24, "Zone2Input" },
-    { 0x25, "Zone2Mute" },
-    { 0x26, "MainVolume" },
-    { 0x27, "Zone2Volume"},
-    { 0x28, "Program"},
-    { 0x29, "TunerPage"},
-    { 0x2A, "PresetNo"},
-    { 0x2B, "Osd"},
-    { 0x2C, "Sleep"},
-    { 0x2D, "ExtendedSurround"},
-    { 0x2E, "SpeakerRelayA"},
-    { 0x2F, "SpeakerRelayB"},
-
-    { 0x34, "Headphone"},
-    { 0x35, "TunerBand"},
-    { 0x3D, "SpeakerBZone"},
-
-    { 0x4B, "Zone2Bass"},
-    { 0x4C, "Zone2Treble"},
-    { 0x4D, "Zone3Bass"},
-    { 0x4E, "Zone3Treble"},
-
-    { 0x5F, "DecoderSelect"},
-
-    { 0x60, "AudioSelect"},
-    { 0x61, "Dimmer"},
-    { 0x6E, "2ChDecoder"},
-
-    { 0x7B, "MultiChannel"},
-
-    { 0x8B, "NightMode"},
-    { 0x8C, "PureDirect"},
-
-    { 0xA0, "Zone3Input"},
-    { 0xA1, "Zone3Mute"},
-    { 0xA2, "Zone3Volume"},
-    { 0xA5, "MuteType"},
-    { 0xA7, "EqualizerType"},
-    { 0xA8, "ToneBypass"},
-
-    { 0xB2, "FanControl"},
-    { 0xB3, "SpeakerImpedance"},
-    { 0xB9, "RemoteSensor"},
-    { 0xBB, "Bi-Amp"},
-    { 0xBD, "WakeOnRs232"},
+    RXV1600_REPORTS(RXV_ENTRY, RXV_ENTRY)
 };
 
 
+// JSON catalog of the tables, one string literal in flash
+#define RXV_CMD_FIRST(name, bytes) "\"" name "\""
+#define RXV_CMD_NEXT(name, bytes) ",\"" name "\""
+#define RXV_VALUE_FIRST(name, fmt, min, max) "{\"name\":\"" name "\",\"min\":" #min ",\"max\":" #max "}"
+#define RXV_VALUE_NEXT(name, fmt, min, max) "," RXV_VALUE_FIRST(name, fmt, min, max)
+#define RXV_REPORT_FIRST(id, name) "\"" #id "\":\"" name "\""
+#define RXV_REPORT_NEXT(id, name) "," RXV_REPORT_FIRST(id, name)
+
+static const char CATALOG[] =
+    "{\"commands\":[" RXV1600_COMMANDS(RXV_CMD_FIRST, RXV_CMD_NEXT) "],"
+    "\"value_commands\":[" RXV1600_VALUE_COMMANDS(RXV_VALUE_FIRST, RXV_VALUE_NEXT) "],"
+    "\"reports\":{" RXV1600_REPORTS(RXV_REPORT_FIRST, RXV_REPORT_NEXT) "}}";
+
+
 static const std::map<uint16_t, const char *> VALS = {
     // System status
     { 0x0000, "Ok" },  // only send new commands in this status
@@ -701,11 +482,21 @@ RxV1600::cmds_iter_t RxV1600::end() {
 }
 
 
-RxV1600::RxV1600() {
+RxV1600::RxV1600() : _divergences(0) {
     memset(_status, UNKNOWN_VALUE, sizeof(_status));
 }
 
 
+const char *RxV1600::catalog() {
+    return CATALOG;
+}
+
+
+size_t RxV1600::catalog_length() {
+    return sizeof(CATALOG) - 1;
+}
+
+
 const char *RxV1600::command(const char *name) {
     auto cmd = CMDS.find(name);
 
@@ -718,7 +509,7 @@ const char *RxV1600::command_value(const char *name, uint8_t value) {
 
     auto fmt = FMTS.find(name);
     if( fmt == FMTS.end() ) return NULL;
-    if( snprintf(cmd, sizeof(cmd), fmt->second, value) >= sizeof(cmd) ) return NULL;
+    if( (size_t)snprintf(cmd, sizeof(cmd), fmt->second, value) >= sizeof(cmd) ) return NULL;
 
     return cmd;
 }
@@ -738,15 +529,20 @@ const char *RxV1600::display_name(uint8_t id) {
 }
 
 
-uint8_t RxV1600::report_value(uint8_t id) {
+uint8_t RxV1600::report_value(uint8_t id) const {
     return _status[id];
 }
 
 
 const char *RxV1600::report_value_string(uint8_t id) {
+    return value_string(id, _status[id]);
+}
+
+
+const char *RxV1600::value_string(uint8_t id, uint8_t value) {
     static char buf[10];
 
-    uint16_t index = id << 8 | _status[id];
+    uint16_t index = id << 8 | value;
     auto val = VALS.find(index);
 
     if( val != VALS.end() ) {
@@ -754,7 +550,7 @@ const char *RxV1600::report_value_string(uint8_t id) {
     }
 
     if( id == 0x26 || id == 0x27 || id == 0xa2 ) {
-        float dB = ((float)_status[id] - 0xc7) / 2;
+        float dB = ((float)value - 0xc7) / 2;
         snprintf(buf, sizeof(buf), "%.1f dB", dB);
         return buf;
     }
@@ -763,6 +559,56 @@ const char *RxV1600::report_value_string(uint8_t id) {
 }
 
 
+size_t RxV1600::state_json(char *buf, size_t size) const {
+    size_t len = 0;
+    int n;
+
+    for( unsigned id = 0; id <= 0xff; id++ ) {
+        const char *name = report_name(id);
+        uint8_t value = _status[id];
+        if( !name || value == (uint8_t)UNKNOWN_VALUE ) continue;
+
+        char *pos = (len < size) ? &buf[len] : NULL;
+        size_t room = (len < size) ? size - len : 0;
+        const char *sep = len ? "," : "{";
+        bool volume = id == 0x26 || id == 0x27 || id == 0xa2;
+        if( volume && value >= 0x27 ) {
+            n = snprintf(pos, room, "%s\"%s\":%.1f", sep, name, ((float)value - 0xc7) / 2);
+        }
+        else if( volume ) {
+            // below the volume range only 0x00 has a name (Infinite), no dB number
+            auto val = VALS.find(id << 8 | value);
+            if( val != VALS.end() ) n = snprintf(pos, room, "%s\"%s\":\"%s\"", sep, name, val->second);
+            else n = snprintf(pos, room, "%s\"%s\":null", sep, name);
+        }
+        else {
+            const char *str = value_string(id, value);
+            if( !str ) continue;
+            n = snprintf(pos, room, "%s\"%s\":\"%s\"", sep, name, str);
+        }
+        if( n > 0 ) len += n;
+    }
+
+    n = snprintf((len < size) ? &buf[len] : NULL, (len < size) ? size - len : 0, len ? "}" : "{}");
+    if( n > 0 ) len += n;
+    return len;
+}
+
+
+bool RxV1600::ready(uint8_t zone) {
+    // Power report values with main zone, zone 2 or zone 3 on
+    static const uint8_t on[] = { 0x36, 0x5A, 0xAA };
+
+    if( zone >= sizeof(on) || _status[0x00] != 0x00 || _status[0x20] > 7 ) return false;
+
+    return on[zone] & (1 << _status[0x20]);
+}
+
+
+// UNKNOWN_VALUE as stored in uint8_t (char may be signed)
+static const uint8_t UNKNOWN = (uint8_t)RxV1600::UNKNOWN_VALUE;
+
+
 static uint8_t nibble( char ch ) {
     if( (ch >= '0') && (ch <= '9') ) {
         return ch - '0';
@@ -782,9 +628,9 @@ bool RxV1600::decode( const char *resp, uint8_t &id, guard_t &guard, origin_t &o
     if( resp[2] < '0' || resp[2] > '2' ) return false;
 
     uint8_t val[4];
-    for( int i=0; i<sizeof(val); i++) {
+    for( size_t i=0; i<sizeof(val); i++) {
         val[i] = nibble(resp[i+3]);
-        if( val[i] == UNKNOWN_VALUE ) return false;
+        if( val[i] == UNKNOWN ) return false;
     }
 
     guard = (guard_t)(resp[2] - '0');
@@ -800,9 +646,9 @@ bool RxV1600::decodeText( const char *resp, uint8_t &id, char *text ) {
     if( resp[0] != *DC1 || resp[11] != *ETX ) return false;
 
     uint8_t val[2];
-    for( int i=0; i<sizeof(val); i++) {
+    for( size_t i=0; i<sizeof(val); i++) {
         val[i] = nibble(resp[i+1]);
-        if( val[i] == UNKNOWN_VALUE ) return false;
+        if( val[i] == UNKNOWN ) return false;
     }
 
     id = (val[0] << 4) | val[1];
@@ -815,13 +661,35 @@ bool RxV1600::decodeText( const char *resp, uint8_t &id, char *text ) {
 }
 
 
-bool RxV1600::decodeConfig( const char *resp, bool &power ) {
+bool RxV1600::decodeConfig( const char *resp, bool &power, uint8_t *changed ) {
+    uint8_t prev[sizeof(_status)];
+    memcpy(prev, _status, sizeof(prev));
+
+    if( !parseConfig(resp, power) ) return false;
+
+    if( changed ) memset(changed, 0, sizeof(_status) / 8);
+    for( unsigned id=0; id<sizeof(_status); id++ ) {
+        if( prev[id] == _status[id] ) continue;
+        if( changed ) changed[id >> 3] |= 1 << (id & 7);
+        if( prev[id] != UNKNOWN ) _divergences++;  // cache was wrong
+    }
+
+    return true;
+}
+
+
+uint32_t RxV1600::divergences() const {
+    return _divergences;
+}
+
+
+bool RxV1600::parseConfig( const char *resp, bool &power ) {
     if( resp[0] != *DC2 ) return false;
 
     uint8_t len = nibble(resp[7]);
-    if( len == UNKNOWN_VALUE ) return false;
+    if( len == UNKNOWN ) return false;
     len = len << 4 | nibble(resp[8]);
-    if( len == UNKNOWN_VALUE ) return false;
+    if( len == UNKNOWN ) return false;
 
     power = !(len == 10);
 
@@ -834,25 +702,25 @@ bool RxV1600::decodeConfig( const char *resp, bool &power ) {
 
     if( !power ) return true;
 
-    if( nibble(*(curr++) == 1) ) _status[0x21] |= 0x10;  // set MultiChannel bit on Input
+    if( nibble(*(curr++)) == 1 ) _status[0x21] |= 0x10;  // set MultiChannel bit on Input
     _status[0x22] = nibble(*(curr++));  // Audio select
     _status[0x23] = nibble(*(curr++));  // Audio mute
     _status[0x24] = nibble(*(curr++));  // Zone 2 input
     _status[0x25] = nibble(*(curr++));  // Zone 2 mute
     _status[0x26] = nibble(*(curr++));  // Main volume hi
-    if( _status[0x26] != UNKNOWN_VALUE )  _status[0x26] = _status[0x26] << 4 | nibble(*(curr++));  // lo
+    if( _status[0x26] != UNKNOWN )  _status[0x26] = _status[0x26] << 4 | nibble(*(curr++));  // lo
     _status[0x27] = nibble(*(curr++));  // Zone 2 volume hi
-    if( _status[0x27] != UNKNOWN_VALUE )  _status[0x27] = _status[0x27] << 4 | nibble(*(curr++));  // lo
+    if( _status[0x27] != UNKNOWN )  _status[0x27] = _status[0x27] << 4 | nibble(*(curr++));  // lo
     _status[0x28] = nibble(*(curr++));  // DSP effect program
-    if( _status[0x28] != UNKNOWN_VALUE )  _status[0x28] = _status[0x28] << 4 | nibble(*(curr++));  // lo
-    if( nibble(*(curr++) == 0) ) _status[0x28] |= 0x80;  // Set Straight bit on program
+    if( _status[0x28] != UNKNOWN )  _status[0x28] = _status[0x28] << 4 | nibble(*(curr++));  // lo
+    if( nibble(*(curr++)) == 0 ) _status[0x28] |= 0x80;  // Set Straight bit on program
     _status[0x2D] = nibble(*(curr++));  // Extended surround
     _status[0x2B] = nibble(*(curr++));  // OSD
     _status[0x2C] = nibble(*(curr++));  // Sleep delay
     _status[0x29] = nibble(*(curr++));  // Tuner preset page
     _status[0x2A] = nibble(*(curr++));  // Tuner preset number
     _status[0x8B] = nibble(*(curr++));  // Night mode hi
-    if( _status[0x8B] != UNKNOWN_VALUE )  _status[0x8B] = _status[0x8B] << 4 | nibble(*(curr++));  // lo
+    if( _status[0x8B] != UNKNOWN )  _status[0x8B] = _status[0x8B] << 4 | nibble(*(curr++));  // lo
     _status[0x2E] = nibble(*(curr++));  // Speaker A
     _status[0x2F] = nibble(*(curr++));  // Speaker B
     _status[0x10] = nibble(*(curr++));  // Playback decoder
@@ -864,7 +732,7 @@ bool RxV1600::decodeConfig( const char *resp, bool &power ) {
     _status[0x35] = nibble(*(curr++));  // Tuner band
     _status[0x15] = nibble(*(curr++));  // Tuner tuned
     curr++;  // DC1 Trigger Output
-    uint8_t n = nibble(*(curr++)); if( n != 0 && n != UNKNOWN_VALUE ) _status[0x22] |= n << 4;  // Decoder mode
+    uint8_t n = nibble(*(curr++)); if( n != 0 && n != UNKNOWN ) _status[0x22] |= n << 4;  // Decoder mode
     curr++;  // Dual mono
     curr++;  // DC1 Trigger Control
     _status[0x16] = nibble(*(curr++));  // DTS 96/24 mode
@@ -887,7 +755,7 @@ bool RxV1600::decodeConfig( const char *resp, bool &power ) {
     _status[0xA0] = nibble(*(curr++));  // Zone 3 input
     _status[0xA1] = nibble(*(curr++));  // Zone 3 mute
     _status[0xA2] = nibble(*(curr++));  // Zone 3 volume hi
-    if( _status[0xA2] != UNKNOWN_VALUE )  _status[0xA2] = _status[0xA2] << 4 | nibble(*(curr++));  // lo
+    if( _status[0xA2] != UNKNOWN )  _status[0xA2] = _status[0xA2] << 4 | nibble(*(curr++));  // lo
     _status[0xB9] = nibble(*(curr++));  // Remote sensor (IR)
     _status[0x7B] = nibble(*(curr++));  // Multi channel select
     curr++;  // Remote ID XM
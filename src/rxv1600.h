@@ -19,6 +19,9 @@
 #include <map>
 
 
+/// Class to encode commands and decode responses of an RX-V1600
+/// Command, report and value tables are static and read-only, so they are shared by all instances.
+/// Each instance only holds the cached report values of one receiver.
 class RxV1600 {
     public:
 
@@ -44,6 +47,16 @@ class RxV1600 {
     static cmds_iter_t begin();
     static cmds_iter_t end();
 
+    /// @brief get JSON catalog of all command names, value commands with their ranges and report names
+    /// e.g. {"commands":["Ready",...],"value_commands":[{"name":"MainVolumeSet","min":39,"max":232},...],
+    /// "reports":{"0x00":"System",...}}, generated at compile time from rxv1600tables.h
+    /// @return constant JSON document
+    static const char *catalog();
+
+    /// @brief get length of the catalog
+    /// @return length without terminating null
+    static size_t catalog_length();
+
     /// @brief get full command bytes to send for given command name
     /// @param name camel cased command name from spec
     /// @return ascii string to send to the RX-V1600 or NULL if name unknown
@@ -69,13 +82,35 @@ class RxV1600 {
     /// @brief get last report value of report id
     /// @param id binary value, i.e. rcmd0,1 = '1','A' -> id = 26
     /// @return value of the report from spec or UNKNOWN_VALUE if id or value not known
-    uint8_t report_value(uint8_t id);
+    uint8_t report_value(uint8_t id) const;
 
     /// @brief get string representation of last value of report id
     /// @param id binary value, i.e. rcmd0,1 = '1','A' -> id = 26
     /// @return value of the report from spec or NULL if id or value not known
     const char *report_value_string(uint8_t id);
 
+    /// @brief get string representation of a report value
+    /// @param id binary value, i.e. rcmd0,1 = '1','A' -> id = 26
+    /// @param value binary value, i.e. rdat0,1 = 'C','7' -> value = 199
+    /// @return value of the report from spec or NULL if id or value not known
+    ///         volumes use internal buffer, invalidated on next call.
+    static const char *value_string(uint8_t id, uint8_t value);
+
+    /// @brief render all known report values as one compact JSON object
+    /// e.g. {"System":"OK","Power":"All On","MainVolume":-20.5,...} in id order
+    /// Volumes are numbers in dB, "Infinite" when muted to 0x00 and null below the volume range,
+    /// all other values are strings as from report_value_string()
+    /// @param buf receives the JSON, truncated if too small
+    /// @param size size of buf
+    /// @return length of the complete JSON (like snprintf), so a larger buffer can be used
+    size_t state_json(char *buf, size_t size) const;
+
+    /// @brief check if the receiver is ready for commands to a powered zone
+    /// Right after power on the cached Ok may still be the one from before, see RXV_READY() for waiting
+    /// @param zone 0 for main zone, 1 for zone 2 or 2 for zone 3
+    /// @return true if last System report (0x00) is Ok and last Power report (0x20) shows the zone on
+    bool ready(uint8_t zone = 0);
+
 
     /// @brief decode and store command or system report (starts with STX)
     /// @param resp complete command string as received from RX-V1600
@@ -93,14 +128,23 @@ class RxV1600 {
     /// @return true if report was valid
     bool decodeText( const char *resp, uint8_t &id, char *text );
 
-    /// @brief decode display text report (starts with DC1)
+    /// @brief decode config response of Ready command (starts with DC2)
     /// @param resp complete command string as received from RX-V1600
     /// @param power true if on (an values beyond DT9 are initialized)
+    /// @param changed NULL or bitmap of 32 bytes, receives a set bit for each report id with a changed value
     /// @return true if report was valid
-    bool decodeConfig( const char *resp, bool &power );
+    bool decodeConfig( const char *resp, bool &power, uint8_t *changed = NULL );
+
+    /// @brief get number of cached report values a config response has corrected
+    /// Values that were unknown before do not count
+    /// @return number of divergences
+    uint32_t divergences() const;
 
 
     private:
 
+    bool parseConfig( const char *resp, bool &power );  // store config values in _status
+
     uint8_t _status[256];  // cached report states of the RX-V1600
+    uint32_t _divergences; // number of cached values corrected by config responses
 };
@@ -0,0 +1,207 @@
+#include "rxv1600batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+static bool is_blank( char c ) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+
+// remove blanks at both ends of a span
+static void trim( RxV1600Batch::span_t &span ) {
+    while( span.len && is_blank(*span.str) ) {
+        span.str++;
+        span.len--;
+    }
+    while( span.len && is_blank(span.str[span.len - 1]) ) {
+        span.len--;
+    }
+}
+
+
+void RxV1600Batch::begin(cursor_t &cur, const char *payload, size_t length) {
+    cur.pos = payload;
+    cur.end = payload + length;
+    cur.error = false;
+
+    while( cur.pos < cur.end && is_blank(*cur.pos) ) cur.pos++;
+    cur.json = (cur.pos < cur.end && *cur.pos == '[');
+    if( cur.json ) cur.pos++;
+}
+
+
+bool RxV1600Batch::next(cursor_t &cur, span_t &item) {
+    while( !cur.json ) {
+        // lines separated by newline or ';'
+        while( cur.pos < cur.end && (is_blank(*cur.pos) || *cur.pos == ';') ) cur.pos++;
+        if( cur.pos == cur.end ) return false;
+
+        item.str = cur.pos;
+        while( cur.pos < cur.end && *cur.pos != '\n' && *cur.pos != '\r' && *cur.pos != ';' ) cur.pos++;
+        item.len = cur.pos - item.str;
+        trim(item);
+        if( item.len ) return true;
+    }
+
+    while( !cur.error ) {
+        // JSON array of strings without escapes, command names never need them
+        while( cur.pos < cur.end && is_blank(*cur.pos) ) cur.pos++;
+        if( cur.pos == cur.end || (*cur.pos != '"' && *cur.pos != ']') ) break;
+
+        if( *cur.pos == ']' ) {
+            // only blanks may follow the array
+            cur.pos++;
+            while( cur.pos < cur.end && is_blank(*cur.pos) ) cur.pos++;
+            if( cur.pos != cur.end ) break;
+            return false;
+        }
+
+        item.str = ++cur.pos;
+        while( cur.pos < cur.end && *cur.pos != '"' && *cur.pos != '\\' ) cur.pos++;
+        if( cur.pos == cur.end || *cur.pos == '\\' ) break;
+        item.len = cur.pos++ - item.str;
+
+        // a comma must be followed by another string
+        while( cur.pos < cur.end && is_blank(*cur.pos) ) cur.pos++;
+        if( cur.pos < cur.end && *cur.pos == ',' ) {
+            cur.pos++;
+            while( cur.pos < cur.end && is_blank(*cur.pos) ) cur.pos++;
+            if( cur.pos == cur.end || *cur.pos != '"' ) break;
+        }
+        else if( cur.pos == cur.end || *cur.pos != ']' ) {
+            break;
+        }
+
+        trim(item);
+        if( item.len ) return true;
+    }
+
+    cur.error = true;
+    cur.pos = cur.end;
+    return false;
+}
+
+
+bool RxV1600Batch::split(span_t &rest, span_t &field) {
+    if( !rest.str ) return false;
+
+    const char *comma = (const char *)memchr(rest.str, ',', rest.len);
+    field.str = rest.str;
+    if( comma ) {
+        field.len = comma - rest.str;
+        rest.len -= field.len + 1;
+        rest.str = comma + 1;
+    }
+    else {
+        field.len = rest.len;
+        rest.str = NULL;
+        rest.len = 0;
+    }
+    trim(field);
+    return true;
+}
+
+
+bool RxV1600Batch::copy(const span_t &span, char *buf, size_t size) {
+    if( span.len >= size ) return false;
+
+    memcpy(buf, span.str, span.len);
+    buf[span.len] = '\0';
+    return true;
+}
+
+
+RxV1600Batch::error_t RxV1600Batch::resolve(const span_t &item, char *cmd) {
+    span_t rest = item;
+    span_t field;
+    char name[NAME_MAX];
+    const char *resolved;
+
+    if( !split(rest, field) || !field.len ) return E_SYNTAX;
+    if( !copy(field, name, sizeof(name)) ) return E_UNKNOWN;
+
+    if( split(rest, field) ) {
+        if( rest.str ) return E_SYNTAX;  // excess argument
+
+        char value[8];
+        char *endp;
+        if( !field.len || !copy(field, value, sizeof(value)) ) return E_VALUE;
+        unsigned long number = strtoul(value, &endp, 0);
+        if( *endp || number > 0xff ) return E_VALUE;
+        resolved = RxV1600::command_value(name, number);
+    }
+    else {
+        resolved = RxV1600::command(name);
+    }
+
+    if( !resolved ) return E_UNKNOWN;
+    strncpy(cmd, resolved, 7);
+    cmd[7] = '\0';
+    return E_OK;
+}
+
+
+const char *RxV1600Batch::error_name(error_t error) {
+    switch( error ) {
+        case E_OK:      return "ok";
+        case E_EMPTY:   return "empty";
+        case E_SYNTAX:  return "syntax error";
+        case E_UNKNOWN: return "unknown command";
+        case E_VALUE:   return "invalid value";
+        default:        return "queue full";
+    }
+}
+
+
+RxV1600Batch::RxV1600Batch(RxV1600Comm &comm) : _comm(comm), _head(0), _count(0) {
+}
+
+
+RxV1600Batch::error_t RxV1600Batch::submit(const char *payload, size_t length, unsigned *failed) {
+    cursor_t cur;
+    span_t item;
+    unsigned count = 0;
+    error_t error = E_OK;
+
+    // resolve into the free slots of the ring, they only count as queued once all are valid
+    begin(cur, payload, length);
+    while( next(cur, item) ) {
+        if( _count + count == CMDS_MAX ) {
+            error = E_FULL;
+            break;
+        }
+        error = resolve(item, _cmds[(_head + _count + count) % CMDS_MAX]);
+        if( error ) break;
+        count++;
+    }
+
+    if( !error && cur.error ) error = E_SYNTAX;
+    if( !error && !count ) error = E_EMPTY;
+    if( error ) {
+        if( failed ) *failed = count;
+        return error;
+    }
+
+    _count += count;
+    return E_OK;
+}
+
+
+unsigned RxV1600Batch::pending() const {
+    return _count;
+}
+
+
+void RxV1600Batch::cancel() {
+    _count = 0;
+}
+
+
+void RxV1600Batch::handle() {
+    if( _count && _comm.send(_cmds[_head]) ) {
+        _head = (_head + 1) % CMDS_MAX;
+        _count--;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// Batches of commands for a Yamaha RX-V1600 AV Receiver in one payload
+// A payload is either lines "Name[,value]" separated by newline or ';', or a JSON array
+// of such strings. It is parsed in place, all commands are validated before any of them
+// is queued, and the queued commands are sent one after the other from handle().
+// Joachim Banzhaf, 2023
+
+#include <rxv1600.h>
+
+
+/// Class to queue validated command batches in fixed memory
+/// A batch is queued completely or not at all, so a scene sent as one message never runs half.
+/// Commands queued by earlier batches keep their order.
+class RxV1600Batch {
+    public:
+
+    static const unsigned CMDS_MAX = 16;  // max queued commands of all batches
+    static const size_t NAME_MAX = 32;    // max length of a command name including EOS
+
+    typedef enum error { E_OK, E_EMPTY, E_SYNTAX, E_UNKNOWN, E_VALUE, E_FULL } error_t;
+
+    /// @brief part of a payload, not null terminated
+    typedef struct span {
+        const char *str;
+        size_t len;
+    } span_t;
+
+    /// @brief position of the parser within a payload
+    typedef struct cursor {
+        const char *pos;  // next byte to parse
+        const char *end;  // end of the payload
+        bool json;        // payload is a JSON array
+        bool error;       // payload is not well formed
+    } cursor_t;
+
+    /// @brief start parsing a payload
+    /// @param cur receives the parser position
+    /// @param payload bytes as received, need not be null terminated
+    /// @param length number of bytes
+    static void begin(cursor_t &cur, const char *payload, size_t length);
+
+    /// @brief get the next command of a payload, empty lines are skipped
+    /// @param cur parser position from begin()
+    /// @param item receives the command without surrounding blanks or quotes
+    /// @return false at the end of the payload or if it is not well formed (cur.error)
+    static bool next(cursor_t &cur, span_t &item);
+
+    /// @brief split the first comma separated field from a command
+    /// @param rest command or its remaining fields, receives the fields after the first
+    /// @param field receives the first field
+    /// @return false if rest is empty
+    static bool split(span_t &rest, span_t &field);
+
+    /// @brief copy a span into a null terminated buffer
+    /// @param span part of a payload
+    /// @param buf receives the string
+    /// @param size size of buf
+    /// @return false if the span does not fit
+    static bool copy(const span_t &span, char *buf, size_t size);
+
+    /// @brief resolve a command "Name[,value]" to the bytes to send
+    /// @param item command as returned by next()
+    /// @param cmd receives the command bytes, at least 8 bytes
+    /// @return E_OK or why the command is invalid
+    static error_t resolve(const span_t &item, char *cmd);
+
+    /// @brief get a short description of an error
+    /// @param error error returned by resolve() or submit()
+    /// @return constant string
+    static const char *error_name(error_t error);
+
+    /// @brief queue batches for a receiver
+    /// @param comm communication used to send the commands
+    RxV1600Batch(RxV1600Comm &comm);
+
+    /// @brief validate all commands of a payload and queue them if all are valid and fit
+    /// @param payload bytes as received, need not be null terminated
+    /// @param length number of bytes
+    /// @param failed NULL or receives the index of the first invalid command
+    /// @return E_OK if the batch is queued
+    error_t submit(const char *payload, size_t length, unsigned *failed = NULL);
+
+    /// @brief get number of commands not yet sent
+    /// @return queued commands
+    unsigned pending() const;
+
+    /// @brief drop all queued commands
+    void cancel();
+
+    /// @brief send queued commands as soon as RxV1600Comm accepts them
+    /// Call this regularly, e.g. after RxV1600Comm::handle()
+    void handle();
+
+    private:
+
+    RxV1600Comm &_comm;
+    char _cmds[CMDS_MAX][8];  // ring of resolved commands
+    unsigned _head;           // next command to send
+    unsigned _count;          // number of queued commands
+};
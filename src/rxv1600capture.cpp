@@ -0,0 +1,136 @@
+#include "rxv1600capture.h"
+
+#include <string.h>
+
+
+#ifdef ESP32
+#define CAPTURE_LOCK()   portENTER_CRITICAL(&_mux)
+#define CAPTURE_UNLOCK() portEXIT_CRITICAL(&_mux)
+#else
+#define CAPTURE_LOCK()   // host builds record and read in one thread
+#define CAPTURE_UNLOCK()
+#endif
+
+
+const char RxV1600Capture::MAGIC[8] = { 'R', 'X', 'V', 'C', 'A', 'P', '1', '\n' };
+
+
+RxV1600Capture::RxV1600Capture(uint8_t *buf, size_t size, RxV1600Clock::micros_t clock) : _buf(buf), _size(size), _micros(clock ? clock : RxV1600Clock::micros),
+        _head(0), _used(0), _records(0), _dropped(0), _paused(false) {
+}
+
+
+uint8_t RxV1600Capture::at( size_t index ) const {
+    return _buf[(_head + _size - _used + index) % _size];
+}
+
+
+void RxV1600Capture::put( uint8_t byte ) {
+    _buf[_head] = byte;
+    _head = (_head + 1) % _size;
+    _used++;
+}
+
+
+void RxV1600Capture::record(dir_t dir, const char *frame, size_t len) {
+    if( len > 0xFF ) len = 0xFF;
+    size_t need = HEADER_SIZE + len;
+    if( need > _size ) return;
+
+    uint32_t us = _micros();
+    CAPTURE_LOCK();
+    if( _paused ) {
+        CAPTURE_UNLOCK();
+        return;
+    }
+
+    while( _size - _used < need ) {
+        // drop oldest record
+        _used -= HEADER_SIZE + at(1);
+        _dropped++;
+    }
+
+    put(dir);
+    put(len);
+    for( unsigned i = 0; i < 4; i++ ) {
+        put(us >> (8 * i));
+    }
+    for( size_t i = 0; i < len; i++ ) {
+        put(frame[i]);
+    }
+    _records++;
+    CAPTURE_UNLOCK();
+}
+
+
+bool RxV1600Capture::pause(bool paused) {
+    // a record in progress completes before a download takes the size
+    CAPTURE_LOCK();
+    bool was = _paused.exchange(paused);
+    CAPTURE_UNLOCK();
+    return was;
+}
+
+
+void RxV1600Capture::clear() {
+    CAPTURE_LOCK();
+    _used = 0;
+    _records = 0;
+    _dropped = 0;
+    CAPTURE_UNLOCK();
+}
+
+
+size_t RxV1600Capture::size() const {
+    CAPTURE_LOCK();
+    size_t used = _used;
+    CAPTURE_UNLOCK();
+    return sizeof(MAGIC) + used;
+}
+
+
+size_t RxV1600Capture::read(size_t offset, uint8_t *dst, size_t len) const {
+    size_t copied = 0;
+
+    while( copied < len && offset < sizeof(MAGIC) ) {
+        dst[copied++] = MAGIC[offset++];
+    }
+    CAPTURE_LOCK();
+    while( copied < len && offset < sizeof(MAGIC) + _used ) {
+        dst[copied++] = at(offset++ - sizeof(MAGIC));
+    }
+    CAPTURE_UNLOCK();
+
+    return copied;
+}
+
+
+uint32_t RxV1600Capture::records() const {
+    return _records;
+}
+
+
+uint32_t RxV1600Capture::dropped() const {
+    return _dropped;
+}
+
+
+bool RxV1600Capture::parse(const uint8_t *data, size_t size, size_t &pos, dir_t &dir, uint32_t &us, const char *&frame, size_t &len) {
+    if( pos == 0 ) {
+        if( size < sizeof(MAGIC) || memcmp(data, MAGIC, sizeof(MAGIC)) != 0 ) return false;
+        pos = sizeof(MAGIC);
+    }
+
+    if( size - pos < HEADER_SIZE || data[pos] > D_ERROR || size - pos - HEADER_SIZE < data[pos + 1] ) return false;
+
+    dir = (dir_t)data[pos];
+    len = data[pos + 1];
+    us = 0;
+    for( unsigned i = 0; i < 4; i++ ) {
+        us |= (uint32_t)data[pos + 2 + i] << (8 * i);
+    }
+    frame = (const char *)&data[pos + HEADER_SIZE];
+    pos += HEADER_SIZE + len;
+
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+// Capture of the serial traffic with a Yamaha RX-V1600 AV Receiver
+// RxV1600Comm records each sent and received frame with a microsecond timestamp
+// into a ring buffer given by the owner. When the buffer is full the oldest frames
+// are dropped. The capture can be downloaded, e.g. over HTTP, and replayed on a host.
+// Recording and downloading may run in different tasks, on ESP32 a spinlock guards the ring.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600clock.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#endif
+
+
+/// Class to record frames into a compact binary ring log
+/// Capture format: the 8 bytes MAGIC followed by the records, oldest first.
+/// Each record is one byte direction, one byte length, 4 bytes little endian
+/// timestamp in µs (wraps after 71 minutes) and the frame bytes.
+/// Frames longer than 255 chars are truncated.
+class RxV1600Capture {
+    public:
+
+    typedef enum dir {
+        D_SENT,   // command written to the receiver
+        D_RECV,   // complete response received
+        D_ERROR   // oversized garbage, or no frame bytes if a command timed out
+    } dir_t;
+
+    static const char MAGIC[8];      // start of a capture, identifies format version
+    static const size_t HEADER_SIZE = 6;  // bytes of a record before the frame
+
+    /// @brief record into a buffer of the owner
+    /// @param buf ring buffer, must live as long as the capture
+    /// @param size bytes of the buffer
+    /// @param clock time source, NULL for micros()
+    RxV1600Capture(uint8_t *buf, size_t size, RxV1600Clock::micros_t clock = NULL);
+
+    /// @brief append a frame, dropping the oldest records if there is not enough room
+    /// @param dir direction of the frame
+    /// @param frame frame bytes
+    /// @param len number of frame bytes
+    void record(dir_t dir, const char *frame, size_t len);
+
+    /// @brief stop or restart recording, e.g. while the capture is downloaded
+    /// @param paused true to ignore records
+    /// @return previous state, true if a download is already running
+    bool pause(bool paused);
+
+    /// @brief drop all records
+    void clear();
+
+    /// @brief get size of the capture as downloaded
+    /// @return bytes including MAGIC
+    size_t size() const;
+
+    /// @brief copy part of the capture, e.g. for a chunked download
+    /// @param offset first byte of the capture to copy
+    /// @param dst destination buffer
+    /// @param len max bytes to copy
+    /// @return number of bytes copied, 0 at the end of the capture
+    size_t read(size_t offset, uint8_t *dst, size_t len) const;
+
+    /// @brief get number of records recorded since start or clear()
+    /// @return number of records, including dropped ones
+    uint32_t records() const;
+
+    /// @brief get number of records dropped because the buffer was full
+    /// @return number of dropped records
+    uint32_t dropped() const;
+
+    /// @brief parse the next record of a downloaded capture
+    /// @param data capture as downloaded, starting with MAGIC
+    /// @param size bytes of the capture
+    /// @param pos offset of the next record, use 0 for the first, advanced to the following record
+    /// @param dir receives the direction
+    /// @param us receives the timestamp
+    /// @param frame receives a pointer to the frame bytes within data
+    /// @param len receives the number of frame bytes
+    /// @return true if a complete record was parsed
+    static bool parse(const uint8_t *data, size_t size, size_t &pos, dir_t &dir, uint32_t &us, const char *&frame, size_t &len);
+
+    private:
+
+    uint8_t at( size_t index ) const;   // ring byte at index relative to oldest record
+    void put( uint8_t byte );           // append byte at head
+
+    uint8_t *_buf;
+    size_t _size;
+    RxV1600Clock::micros_t _micros;
+    size_t _head;        // index of next byte to write
+    size_t _used;        // bytes of records in the ring
+    uint32_t _records;   // records since start or clear
+    uint32_t _dropped;   // records dropped to make room
+    std::atomic<bool> _paused;  // ignore records while true
+#ifdef ESP32
+    mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+};
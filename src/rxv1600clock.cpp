@@ -0,0 +1,13 @@
+#include "rxv1600clock.h"
+
+#include <Arduino.h>
+
+
+uint32_t RxV1600Clock::millis() {
+    return ::millis();
+}
+
+
+uint32_t RxV1600Clock::micros() {
+    return ::micros();
+}
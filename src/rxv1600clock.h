@@ -0,0 +1,28 @@
+#pragma once
+
+// Clocks of the Yamaha RX-V1600 classes
+// Each class takes an optional clock function, so host tests can run on virtual time.
+// Without one they use the Arduino clocks wrapped here.
+// Joachim Banzhaf, 2023
+
+#include <stdint.h>
+
+
+/// Class with the clock function types and the default clocks
+class RxV1600Clock {
+    public:
+
+    /// @brief type of function returning the current time in ms, like millis()
+    typedef uint32_t (* millis_t)();
+
+    /// @brief type of function returning the current time in µs, like micros()
+    typedef uint32_t (* micros_t)();
+
+    /// @brief default ms clock (millis() returns unsigned long on some platforms)
+    /// @return millis() truncated to 32 bits
+    static uint32_t millis();
+
+    /// @brief default µs clock (micros() returns unsigned long on some platforms)
+    /// @return micros() truncated to 32 bits
+    static uint32_t micros();
+};
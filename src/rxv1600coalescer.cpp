@@ -0,0 +1,63 @@
+#include "rxv1600coalescer.h"
+
+#include <string.h>
+
+
+RxV1600Coalescer::RxV1600Coalescer(const RxV1600 &rxv, uint32_t window_ms, publish_t publish, void *ctx, RxV1600Clock::millis_t clock) :
+        _rxv(rxv), _window_ms(window_ms), _publish(publish), _ctx(ctx), _millis(clock ? clock : RxV1600Clock::millis),
+        _suppressed(0) {
+    memset(_published, RxV1600::UNKNOWN_VALUE, sizeof(_published));
+    memset(_pending, 0, sizeof(_pending));
+}
+
+
+void RxV1600Coalescer::changed(uint8_t id) {
+    uint8_t bit = 1 << (id & 7);
+
+    if( _pending[id >> 3] & bit ) {
+        _suppressed++;  // the pending publish will carry this value
+        return;
+    }
+    _pending[id >> 3] |= bit;
+    _since_ms[id] = _millis();
+}
+
+
+void RxV1600Coalescer::handle() {
+    uint32_t now = _millis();
+
+    for( unsigned byte = 0; byte < sizeof(_pending); byte++ ) {
+        if( !_pending[byte] ) continue;
+
+        for( unsigned bit = 0; bit < 8; bit++ ) {
+            uint8_t id = byte << 3 | bit;
+            if( !(_pending[byte] & (1 << bit)) || now - _since_ms[id] < _window_ms ) continue;
+
+            _pending[byte] &= ~(1 << bit);
+            uint8_t value = _rxv.report_value(id);
+            if( value == (uint8_t)RxV1600::UNKNOWN_VALUE ) continue;
+            if( value == _published[id] ) {
+                _suppressed++;
+                continue;
+            }
+            _published[id] = value;
+            if( _publish ) (*_publish)(id, _ctx);
+        }
+    }
+}
+
+
+void RxV1600Coalescer::republish() {
+    uint32_t now = _millis();
+
+    for( unsigned id = 0; id <= 0xff; id++ ) {
+        _since_ms[id] = now;
+    }
+    memset(_published, RxV1600::UNKNOWN_VALUE, sizeof(_published));
+    memset(_pending, 0xff, sizeof(_pending));  // unknown values are skipped by handle()
+}
+
+
+uint32_t RxV1600Coalescer::suppressed() const {
+    return _suppressed;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Change-only publishing of the report values of a Yamaha RX-V1600 AV Receiver
+// Reports repeat values the receiver already sent, and volume ramps change a value
+// every few ms. Changed ids wait for a window, so only their latest value is
+// published, and only if it differs from the last published one.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600.h>
+
+
+/// Class to coalesce report changes into one publish per id and window
+/// The window of an id starts with its first change after its last publish.
+/// Values are read from the RxV1600 cache when the window has passed.
+class RxV1600Coalescer {
+    public:
+
+    /// @brief type of function publishing the current value of a report
+    /// @param id report id, value is rxv.report_value(id)
+    /// @param ctx context as given to the constructor
+    typedef void (* publish_t)(uint8_t id, void *ctx);
+
+    /// @brief coalesce the reports cached by a decoder
+    /// @param rxv decoder with the cached report values
+    /// @param window_ms time to wait for further changes of an id, 0 for next handle()
+    /// @param publish function publishing a value
+    /// @param ctx context to hand over to publish
+    /// @param clock time source, NULL for millis()
+    RxV1600Coalescer(const RxV1600 &rxv, uint32_t window_ms, publish_t publish, void *ctx = NULL, RxV1600Clock::millis_t clock = NULL);
+
+    /// @brief note a report id that was decoded, e.g. from the recv callback
+    /// @param id report id
+    void changed(uint8_t id);
+
+    /// @brief publish ids whose window has passed and whose value differs, call from loop()
+    void handle();
+
+    /// @brief publish all known values again after the window, e.g. when the broker may have lost retained values
+    void republish();
+
+    /// @brief get number of changes not published, because a window coalesced them or the value was unchanged
+    /// @return count since construction
+    uint32_t suppressed() const;
+
+    private:
+
+    const RxV1600 &_rxv;
+    uint32_t _window_ms;
+    publish_t _publish;
+    void *_ctx;
+    RxV1600Clock::millis_t _millis;
+    uint8_t _published[256];  // last published values, UNKNOWN_VALUE if none
+    uint8_t _pending[32];     // bitmap of ids waiting for their window
+    uint32_t _since_ms[256];  // start of the window of pending ids
+    uint32_t _suppressed;
+};
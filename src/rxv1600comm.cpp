@@ -1,29 +1,67 @@
 #include "rxv1600comm.h"
 
-#include <Arduino.h>
-#include <stdarg.h>
+#include <rxv1600log.h>
 
-// forward declaration of debug printf implemented in main firmware
-extern void dbg_printf(const char *fmt, ...);
+#include <Arduino.h>
 
 
 const uint32_t RxV1600Comm::TIMEOUT_MS = 1000;
+const uint32_t RxV1600Comm::GAP_MS = 50;
 const unsigned RxV1600Comm::MAX_TRIES = 5;
+const uint32_t RxV1600Comm::BUSY_MS = 10000;
+const uint32_t RxV1600Comm::PROBE_MIN_MS = 250;
+const uint32_t RxV1600Comm::PROBE_MAX_MS = 8000;
+const uint32_t RxV1600Comm::IDLE_MS = 1000;
 
 
-RxV1600Comm::RxV1600Comm(Stream &stream) : _stream(stream), _cb(NULL), _cmd(NULL), _pos(0) {
+RxV1600Comm::RxV1600Comm(Stream &stream, RxV1600Clock::millis_t clock) : _stream(stream), _millis(clock ? clock : RxV1600Clock::millis), _cb(NULL), _cmd(NULL), _pos(0), _tries(0), _gap_ms(0), 
+        _system(SYSTEM_UNKNOWN), _system_ms(0), _blocked_since(0), _blocked_ms(0), _blocked_count(0),
+        _link(LINK_HEALTHY), _link_cb(NULL), _link_ctx(NULL), _probing(false), _probe_ms(0), _backoff_ms(PROBE_MIN_MS),
+        _reconcile_interval_ms(0), _reconcile_ms(0), _reconciles(0), _active_ms(0),
+        _in_cb(false), _defer_head(0), _defer_count(0), _capture(NULL),
+        _awaiting(false), _framed(false), _frame_ms(0) {
     _cmd_buf[0] = '\0';
+    reset_metrics();
+}
+
+
+uint32_t RxV1600Comm::now() const {
+    return _millis();
 }
 
 
 bool RxV1600Comm::send(const char *cmd) {
-    if( _cmd ) return false;
+    if( _in_cb ) {
+        // re-entrant: queue in deferred lane, handle() activates it later
+        if( _defer_count == DEFER_MAX ) {
+            _metrics.rejected++;
+            return false;
+        }
+        char *buf = _defer[(_defer_head + _defer_count++) % DEFER_MAX];
+        strncpy(buf, cmd, sizeof(_cmd_buf) - 1);
+        buf[sizeof(_cmd_buf) - 1] = '\0';
+        return true;
+    }
+
+    if( _cmd || _defer_count || _link == LINK_LOST ) {
+        _metrics.rejected++;
+        return false;
+    }
+    activate(cmd);
+    return true;
+}
+
+
+void RxV1600Comm::activate( const char *cmd ) {
     strncpy(_cmd_buf, cmd, sizeof(_cmd_buf) - 1);
     _cmd_buf[sizeof(_cmd_buf) - 1] = '\0';
     _cmd = _cmd_buf;
-    _pos = 0;
-    _tries = 0;
-    return true;
+    _tries = 0;  // keep _pos: a response may be partially received already
+}
+
+
+unsigned RxV1600Comm::deferred() const {
+    return _defer_count;
 }
 
 
@@ -33,61 +71,278 @@ void RxV1600Comm::on_recv(recv_t cb, void *ctx) {
 }
 
 
+void RxV1600Comm::on_link(link_cb_t cb, void *ctx) {
+    _link_cb = cb;
+    _link_ctx = ctx;
+}
+
+
+RxV1600Comm::link_t RxV1600Comm::link() const {
+    return _link;
+}
+
+
+const char *RxV1600Comm::link_name(link_t link) {
+    switch( link ) {
+        case LINK_HEALTHY:  return "Healthy";
+        case LINK_DEGRADED: return "Degraded";
+        default:            return "Lost";
+    }
+}
+
+
+void RxV1600Comm::reconcile(uint32_t interval_ms) {
+    _reconcile_interval_ms = interval_ms;
+    _reconcile_ms = _millis();
+}
+
+
+uint32_t RxV1600Comm::reconciles() const {
+    return _reconciles;
+}
+
+
+void RxV1600Comm::capture(RxV1600Capture *capture) {
+    _capture = capture;
+}
+
+
+void RxV1600Comm::metrics(metrics_t &snapshot) const {
+    snapshot = _metrics;
+}
+
+
+void RxV1600Comm::reset_metrics() {
+    memset(&_metrics, 0, sizeof(_metrics));
+}
+
+
+unsigned RxV1600Comm::bucket(uint32_t ms) {
+    unsigned index = 0;
+    while( ms && index < HIST_BUCKETS - 1 ) {
+        ms >>= 1;
+        index++;
+    }
+    return index;
+}
+
+
+uint32_t RxV1600Comm::bucket_min(unsigned index) {
+    return index ? 1UL << (index - 1) : 0;
+}
+
+
+void RxV1600Comm::set_link( link_t link ) {
+    if( link == _link ) return;
+
+    _link = link;
+    RXV_LOGI("link %s", link == LINK_HEALTHY ? "healthy" : link == LINK_DEGRADED ? "degraded" : "lost");
+    if( _link_cb ) {
+        (*_link_cb)(link, _link_ctx);
+    }
+}
+
+
+void RxV1600Comm::probe( uint32_t now ) {
+    // discard whatever partial data is buffered
+    while( _stream.available() ) {
+        _stream.read();
+        _metrics.noise++;
+    }
+    _pos = 0;
+
+    // one try of a Ready command
+    strcpy(_cmd_buf, DC1 "000" ETX);
+    _cmd = _cmd_buf;
+    _tries = MAX_TRIES - 1;
+    _probing = true;
+    _probe_ms = now;
+}
+
+
+bool RxV1600Comm::system_status() {
+    uint8_t status = SYSTEM_UNKNOWN;
+    bool report = false;
+
+    if( _pos == 8 && _resp[0] == *STX && strncmp(&_resp[3], "000", 3) == 0 ) {
+        // System report
+        status = _resp[6] - '0';
+        report = true;
+    }
+    else if( _pos > 16 && _resp[0] == *DC2 ) {
+        // Config response: System is DT7
+        status = _resp[16] - '0';
+    }
+
+    if( status <= SYSTEM_STANDBY && status != _system ) {
+        _system = status;
+        _system_ms = _millis();
+    }
+
+    return report;
+}
+
+
+bool RxV1600Comm::blocked( uint32_t now ) {
+    // hold commands while busy, unless the Ok report got lost
+    bool busy = _cmd && _system == SYSTEM_BUSY && now - _system_ms < BUSY_MS;
+
+    if( busy && !_blocked_since ) {
+        _blocked_since = (now - 1) | 1;
+        _blocked_count++;
+    }
+    else if( !busy && _blocked_since ) {
+        _blocked_ms += now - _blocked_since;
+        _blocked_since = 0;
+    }
+
+    return busy;
+}
+
+
+void RxV1600Comm::frame_start( uint32_t now ) {
+    if( _awaiting ) {
+        // first response after writing a command
+        _metrics.latency[bucket(now - _sent_ms)]++;
+        _metrics.latency_sum += now - _sent_ms;
+        _awaiting = false;
+    }
+    if( _framed ) {
+        _metrics.gap[bucket(now - _frame_ms)]++;
+        _metrics.gap_sum += now - _frame_ms;
+        _framed = false;
+    }
+}
+
+
 void RxV1600Comm::respond( bool valid ) {
     _resp[_pos] = '\0';
-    dbg_printf("DEBUG: recv '%s'\n", _resp);
+    RXV_LOGD("recv '%s'", _resp);
+    if( _capture ) {
+        _capture->record(valid ? RxV1600Capture::D_RECV : RxV1600Capture::D_ERROR, _resp, _pos);
+    }
 
-    _cmd = NULL;  // stop resending current command
+    // System reports around a busy period do not answer the command, it is sent again once Ok.
+    // A hold that expired like in blocked() is not renewed, the report then ends the command as usual
+    uint8_t system = _system;
+    bool held = false;
+    if( valid ) {
+        _metrics.frames++;
+        _framed = true;
+        _frame_ms = _millis();
+        held = system_status() && _cmd && (system == SYSTEM_BUSY || _system == SYSTEM_BUSY)
+            && _millis() - _system_ms < BUSY_MS;
+        if( _resp[0] == *DC2 ) _reconcile_ms = _millis();
+        _backoff_ms = PROBE_MIN_MS;
+        set_link(LINK_HEALTHY);
+    }
+    _probing = false;
+
+    if( held ) _tries = 0;
+    else if( _tries ) _cmd = NULL;  // stop resending current command, unless not yet sent
     _pos = 0;     // reset response pointer
     if( _cb ) {
         // tell the callback a full response is available or an error occurred
+        _in_cb = true;
         (*_cb)(valid ? _resp : NULL, _ctx);
+        _in_cb = false;
     }
 }
 
 
 void RxV1600Comm::handle() {
-    static const uint32_t comm_delay = 50;  // min delay before sending after receiving data 
-    static uint32_t last_comm = 0;
-    uint32_t now = millis();
+    uint32_t now = _millis();
 
     while( _stream.available() ) {
-        _cmd = NULL;
         // RX-V1600 has sent something
         _resp[_pos] = _stream.read();
         if( _pos == 0 && (*_resp != *STX && *_resp != *DC1 && *_resp != *DC2 && *_resp != *DC3) ) {
             // not the start of a response
             *_resp = '\0';
+            _metrics.noise++;
         }
-        else if( _resp[_pos++] == '\x03' ) {
-            // this was the last char of a response
-            respond(true);
-        }
-        else if( _pos == sizeof(_resp) - 1 ) {
-            // discard oversized response
-            respond(false);
+        else {
+            if( _pos == 0 ) frame_start(now);
+            if( _resp[_pos++] == '\x03' ) {
+                // this was the last char of a response
+                respond(true);
+            }
+            else if( _pos == sizeof(_resp) - 1 ) {
+                // discard oversized response
+                _metrics.oversized++;
+                RXV_LOGW("discarded oversized response");
+                if( _link == LINK_HEALTHY ) set_link(LINK_DEGRADED);
+                respond(false);
+            }
         }
-        last_comm = (now - 1) | 1;
+        _gap_ms = (now - 1) | 1;
+        _active_ms = now;
+    }
+
+    if( _gap_ms && now - _gap_ms > GAP_MS ) {
+        _gap_ms = 0;
     }
 
-    if( last_comm && now - last_comm > comm_delay ) {
-        last_comm = 0;
+    if( _link == LINK_LOST && !_cmd && now - _probe_ms >= _backoff_ms ) {
+        probe(now);
     }
 
-    if( !last_comm && _cmd ) {
+    if( _defer_count && !_cmd && _link != LINK_LOST ) {
+        // commands sent from within callbacks go first
+        activate(_defer[_defer_head]);
+        _defer_head = (_defer_head + 1) % DEFER_MAX;
+        _defer_count--;
+    }
+
+    if( _reconcile_interval_ms && !_gap_ms && !_cmd && !_defer_count && _link != LINK_LOST
+            && now - _reconcile_ms >= _reconcile_interval_ms && now - _active_ms >= IDLE_MS ) {
+        // low priority: only if no command is active and nothing was sent or received for a while
+        activate(DC1 "000" ETX);
+        _reconcile_ms = now;
+        _reconciles++;
+    }
+
+    bool hold = blocked(now);
+
+    if( !_gap_ms && _cmd && !hold ) {
         // command request ongoing
         if( !_tries || now - _sent_ms > TIMEOUT_MS ) {
             // command should be sent
             if( ++_tries > MAX_TRIES ) {
                 // too many tries timed out: give up
-                respond(false);
+                _metrics.timeouts++;
+                _awaiting = false;
+                if( _probing ) {
+                    // still lost: try again later, quiet for the recv callback
+                    _cmd = NULL;
+                    _probing = false;
+                    _probe_ms = now;  // backoff starts after the probe timed out
+                    _backoff_ms = (_backoff_ms * 2 > PROBE_MAX_MS) ? PROBE_MAX_MS : _backoff_ms * 2;
+                }
+                else {
+                    RXV_LOGW("no response to '%s'", _cmd);
+                    set_link(LINK_LOST);
+                    _probe_ms = now;
+                    respond(false);
+                }
             }
             else {
+                if( _tries > 1 && !_probing ) {
+                    // retry
+                    _metrics.retries++;
+                    if( _link == LINK_HEALTHY ) set_link(LINK_DEGRADED);
+                }
                 // start timeout and send the command
                 _sent_ms = now;
                 _stream.print(_cmd);
-                last_comm = (now - 1) | 1;
-                dbg_printf("DEBUG: sent '%s'\n", _cmd);
+                _metrics.sent++;
+                _awaiting = true;
+                if( _capture ) {
+                    _capture->record(RxV1600Capture::D_SENT, _cmd, strlen(_cmd));
+                }
+                _gap_ms = (now - 1) | 1;
+                _active_ms = now;
+                RXV_LOGD("sent '%s'", _cmd);
             }
         }
     }
@@ -96,4 +351,19 @@ void RxV1600Comm::handle() {
 
 void RxV1600Comm::abort() {
     _tries = MAX_TRIES;
-}
\ No newline at end of file
+}
+
+
+uint8_t RxV1600Comm::system() const {
+    return _system;
+}
+
+
+uint32_t RxV1600Comm::blocked_ms() const {
+    return _blocked_since ? _blocked_ms + _millis() - _blocked_since : _blocked_ms;
+}
+
+
+uint32_t RxV1600Comm::blocked_count() const {
+    return _blocked_count;
+}
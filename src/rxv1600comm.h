@@ -1,5 +1,8 @@
 #pragma once
 
+#include <rxv1600capture.h>
+#include <rxv1600clock.h>
+
 #include <Stream.h>
 
 // ASCII control characters used by the protocol
@@ -15,32 +18,138 @@
 /// Each sent command triggers at least one callback.
 /// Since the RX-V1600 sends two responses for some commands and messages on status changes
 /// there is no strict 1:1 correlation between send and callback
+/// Commands are held back while the receiver reports its System status as Busy
+/// Link health is tracked: retries or garbled responses degrade the link, giving up on a command
+/// loses it. A lost link is recovered in place by probing with Ready at increasing intervals.
+/// The config response of a successful probe is handed to the callback like any other response.
+/// Optionally Ready is also sent at a low priority interval while the bus is idle, so the
+/// owner of the callback can reconcile its cached state against the config response.
+/// Commands sent from within the receive callback go to a deferred lane. Ordering guarantees:
+///   - deferred commands are sent in the order they were queued, each with the usual retries
+///   - they are sent after the response that triggered them is completely handled
+///   - they are sent before any command that is sent from outside a callback later on,
+///     i.e. send() outside callbacks returns false until the deferred lane is empty
+/// Optionally all sent and received frames are recorded into an RxV1600Capture
+/// Counters and latency histograms of fixed size are kept for monitoring, see metrics()
+/// All state is per instance, so one program can handle several receivers on separate serial ports
 class RxV1600Comm {
     public:
 
+    typedef enum link { LINK_HEALTHY, LINK_DEGRADED, LINK_LOST } link_t;
+
     /// @brief type of function called when a complete response is received
     /// @param resp complete response received, NULL on error
     /// @param ctx context as given when the callback was registered
     typedef void (* recv_t)(const char *resp, void *ctx);
 
+    /// @brief type of function called when the link health changes
+    /// @param link new link state
+    /// @param ctx context as given when the callback was registered
+    typedef void (* link_cb_t)(link_t link, void *ctx);
+
     static const uint32_t TIMEOUT_MS;  // how long until giving up on receiving a full response
+    static const uint32_t GAP_MS;      // min delay before sending after receiving data
     static const unsigned MAX_TRIES;   // how many times to retry sending a command
+    static const uint32_t BUSY_MS;     // how long to hold commands while receiver is busy
+    static const uint32_t PROBE_MIN_MS;  // first delay before probing a lost link
+    static const uint32_t PROBE_MAX_MS;  // max delay between probes of a lost link
+    static const uint32_t IDLE_MS;     // how long the bus must be quiet before reconciling
+    static const unsigned DEFER_MAX = 4;  // max commands queued from within callbacks
+    static const unsigned HIST_BUCKETS = 16;  // log2 buckets of the metrics histograms
+
+    // System status as reported by the receiver (report 0x00)
+    static const uint8_t SYSTEM_OK = 0;
+    static const uint8_t SYSTEM_BUSY = 1;
+    static const uint8_t SYSTEM_STANDBY = 2;
+    static const uint8_t SYSTEM_UNKNOWN = 0xff;
+
+    /// Communication counters and histograms since start or reset_metrics()
+    /// Histogram bucket 0 counts 0 ms, bucket i counts [2^(i-1), 2^i) ms, the last bucket everything above.
+    typedef struct metrics {
+        uint32_t sent;          // commands written, including retries and probes
+        uint32_t retries;       // commands written again after a timeout
+        uint32_t timeouts;      // commands given up after MAX_TRIES, including probes
+        uint32_t frames;        // complete responses received
+        uint32_t noise;         // discarded bytes outside of responses
+        uint32_t oversized;     // discarded responses too long for the receive buffer
+        uint32_t rejected;      // send() calls refused: command active, link lost or deferred lane full
+        uint32_t latency[HIST_BUCKETS];  // from writing a command to the first response char
+        uint32_t gap[HIST_BUCKETS];      // from the end of a response to the start of the next one
+        uint32_t latency_sum;   // sum of all latencies in ms
+        uint32_t gap_sum;       // sum of all gaps in ms
+    } metrics_t;
 
     /// @brief handle communication with an RX-V1600 via serial connection
     /// @param stream serial port connected to the RX-V1600.
     ///        Initialize to 9600 baud 8N1 before calling handle()
-    RxV1600Comm(Stream &stream);
+    /// @param clock time source, NULL for millis(). Tests use a virtual clock
+    RxV1600Comm(Stream &stream, RxV1600Clock::millis_t clock = NULL);
+
+    /// @brief get current time of the clock used by this instance
+    /// @return time in ms
+    uint32_t now() const;
 
     /// @brief trigger sending a command to the receiver during next handle()
+    /// From within the receive callback the command is queued in the deferred lane instead
     /// @param cmd the full command string to send
-    /// @return true if no other command is still active
+    /// @return true if no other command is still active and the link is not lost
+    ///         or, from within the callback, if the deferred lane has room
     bool send(const char *cmd);
 
+    /// @brief get number of commands in the deferred lane
+    /// @return number of commands queued from within callbacks and not yet active
+    unsigned deferred() const;
+
     /// @brief register a function that is called once a request is done
     /// @param cb the callback function
     /// @param ctx context to hand over to the callback
     void on_recv(recv_t cb, void *ctx);
 
+    /// @brief register a function that is called when the link health changes
+    /// @param cb the callback function
+    /// @param ctx context to hand over to the callback
+    void on_link(link_cb_t cb, void *ctx);
+
+    /// @brief get current link health
+    /// @return link state
+    link_t link() const;
+
+    /// @brief get readable link state
+    /// @param link link state
+    /// @return "Healthy", "Degraded" or "Lost"
+    static const char *link_name(link_t link);
+
+    /// @brief periodically send Ready while the bus is idle
+    /// The interval restarts with every config response, also if Ready was sent by the user.
+    /// While the reconciling Ready is active, send() returns false like for any other command.
+    /// @param interval_ms time between config responses, 0 (the default) disables reconciling
+    void reconcile(uint32_t interval_ms);
+
+    /// @brief get number of Ready commands sent for reconciling
+    /// @return number of reconciles
+    uint32_t reconciles() const;
+
+    /// @brief record all frames sent and received from now on
+    /// @param capture ring log to record into or NULL to stop recording
+    void capture(RxV1600Capture *capture);
+
+    /// @brief get a copy of the metrics
+    /// @param snapshot receives the current counters and histograms
+    void metrics(metrics_t &snapshot) const;
+
+    /// @brief set all metrics to 0
+    void reset_metrics();
+
+    /// @brief get histogram bucket of a value
+    /// @param ms value in ms
+    /// @return bucket index
+    static unsigned bucket(uint32_t ms);
+
+    /// @brief get lower limit of a histogram bucket, e.g. for publishing
+    /// @param index bucket index
+    /// @return smallest value in ms counted in the bucket
+    static uint32_t bucket_min(unsigned index);
+
     /// @brief check if a response comes in and if a timeout occurred to resend a command or give up
     /// If a response is fully received or a sent command took too long the registered callback is called
     void handle();
@@ -50,17 +159,62 @@ class RxV1600Comm {
     /// Either on timeout or on getting the full response
     void abort();
 
+    /// @brief get last System status seen in a report or config response
+    /// @return one of the SYSTEM_* values
+    uint8_t system() const;
+
+    /// @brief get time commands were held back because the receiver was busy
+    /// @return total time in ms
+    uint32_t blocked_ms() const;
+
+    /// @brief get number of times commands were held back because the receiver was busy
+    /// @return number of blocked periods
+    uint32_t blocked_count() const;
+
     private:
 
+    bool system_status();   // track System status from the current response, true if it is a System report
+    bool blocked( uint32_t now );  // check if sending is on hold and count blocked time
+    void set_link( link_t link );  // change link state and invoke link callback
+    void probe( uint32_t now );    // flush and send Ready to recover a lost link
+
+    void frame_start( uint32_t now );  // update latency and gap metrics
     void respond( bool valid );  // invoke callback and prepare for receiving the next response
+    void activate( const char *cmd );  // make cmd the active command
 
     Stream &_stream;
+    RxV1600Clock::millis_t _millis;
     recv_t _cb;
     char _cmd_buf[8];    // copy of command to send (max command length is 7)
     const char *_cmd;    // points to _cmd_buf while sending
     size_t _pos;        // received chars
     unsigned _tries;    // number of send tries
     uint32_t _sent_ms;  // start of current try
+    uint32_t _gap_ms;   // time of last sent or received char or 0 if gap has passed
     void *_ctx;         // context by/for the callback implementor
     char _resp[268];    // length of full config response (157) probably enough
+    uint8_t _system;    // last reported System status
+    uint32_t _system_ms;      // when System status changed
+    uint32_t _blocked_since;  // start of current blocked period or 0
+    uint32_t _blocked_ms;     // total blocked time of finished periods
+    uint32_t _blocked_count;  // number of blocked periods
+    link_t _link;             // link health
+    link_cb_t _link_cb;
+    void *_link_ctx;
+    bool _probing;            // current command is a probe of a lost link
+    uint32_t _probe_ms;       // time the link was lost or the last probe timed out
+    uint32_t _backoff_ms;     // delay until next probe
+    uint32_t _reconcile_interval_ms;  // 0 or time between config responses
+    uint32_t _reconcile_ms;   // time of last config response or reconciling Ready
+    uint32_t _reconciles;     // number of reconciling Ready commands
+    uint32_t _active_ms;      // time of last sent or received data
+    bool _in_cb;              // recv callback is running
+    char _defer[DEFER_MAX][sizeof(_cmd_buf)];  // ring of commands sent from within callbacks
+    unsigned _defer_head;     // index of oldest deferred command
+    unsigned _defer_count;    // number of deferred commands
+    RxV1600Capture *_capture; // NULL or ring log of all frames
+    metrics_t _metrics;
+    bool _awaiting;           // a command was written (at _sent_ms) and no response started yet
+    bool _framed;             // a response ended (at _frame_ms) and no other started yet
+    uint32_t _frame_ms;       // time the last response ended
 };
@@ -0,0 +1,39 @@
+#include "rxv1600log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+
+RxV1600Log::sink_t RxV1600Log::_sink = NULL;
+void *RxV1600Log::_ctx = NULL;
+
+
+void RxV1600Log::sink(sink_t sink, void *ctx) {
+    _sink = sink;
+    _ctx = ctx;
+}
+
+
+void RxV1600Log::printf(level_t level, const char *fmt, ...) {
+    sink_t sink = _sink;
+    if( !sink ) return;
+
+    char line[LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    (*sink)(level, line, _ctx);
+}
+
+
+const char *RxV1600Log::level_name(level_t level) {
+    switch( level ) {
+        case L_ERROR: return "E";
+        case L_WARN:  return "W";
+        case L_INFO:  return "I";
+        case L_DEBUG: return "D";
+        default:      return "?";
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+// Compile-time log levels of the library
+// Log statements above RXV1600_LOG_LEVEL are removed by the preprocessor, including
+// the evaluation of their arguments. Enabled statements are formatted into a line
+// and handed to a sink set by the application. Without a sink nothing is formatted.
+// Build with e.g. -DRXV1600_LOG_LEVEL=RXV1600_LOG_DEBUG, default is RXV1600_LOG_NONE.
+// Joachim Banzhaf, 2023
+
+#include <stddef.h>
+
+
+#define RXV1600_LOG_NONE  0
+#define RXV1600_LOG_ERROR 1
+#define RXV1600_LOG_WARN  2
+#define RXV1600_LOG_INFO  3
+#define RXV1600_LOG_DEBUG 4
+
+#ifndef RXV1600_LOG_LEVEL
+#define RXV1600_LOG_LEVEL RXV1600_LOG_NONE
+#endif
+
+#if RXV1600_LOG_LEVEL >= RXV1600_LOG_ERROR
+#define RXV_LOGE(...) RxV1600Log::printf(RxV1600Log::L_ERROR, __VA_ARGS__)
+#else
+#define RXV_LOGE(...) do {} while( 0 )
+#endif
+
+#if RXV1600_LOG_LEVEL >= RXV1600_LOG_WARN
+#define RXV_LOGW(...) RxV1600Log::printf(RxV1600Log::L_WARN, __VA_ARGS__)
+#else
+#define RXV_LOGW(...) do {} while( 0 )
+#endif
+
+#if RXV1600_LOG_LEVEL >= RXV1600_LOG_INFO
+#define RXV_LOGI(...) RxV1600Log::printf(RxV1600Log::L_INFO, __VA_ARGS__)
+#else
+#define RXV_LOGI(...) do {} while( 0 )
+#endif
+
+#if RXV1600_LOG_LEVEL >= RXV1600_LOG_DEBUG
+#define RXV_LOGD(...) RxV1600Log::printf(RxV1600Log::L_DEBUG, __VA_ARGS__)
+#else
+#define RXV_LOGD(...) do {} while( 0 )
+#endif
+
+
+/// Class routing enabled log statements of the library to the application
+class RxV1600Log {
+    public:
+
+    static const size_t LINE_MAX = 128;  // longer lines are truncated
+
+    typedef enum level { L_ERROR = RXV1600_LOG_ERROR, L_WARN, L_INFO, L_DEBUG } level_t;
+
+    /// @brief type of function receiving formatted log lines
+    /// Called from the context of the logging code, e.g. within RxV1600Comm::handle(),
+    /// so it must not block: queue the line or drop it if the output is busy.
+    /// @param level severity of the line
+    /// @param line formatted line without newline, only valid during the call
+    /// @param ctx context as given to sink()
+    typedef void (* sink_t)(level_t level, const char *line, void *ctx);
+
+    /// @brief set the receiver of log lines
+    /// @param sink function receiving the lines, NULL to discard them unformatted
+    /// @param ctx context to hand over to sink
+    static void sink(sink_t sink, void *ctx = NULL);
+
+    /// @brief format a line and hand it to the sink, use the RXV_LOG*() macros instead
+    /// @param level severity of the line
+    /// @param fmt printf format
+    static void printf(level_t level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    /// @brief get short name of a level, e.g. for prefixes
+    /// @param level severity
+    /// @return "E", "W", "I" or "D"
+    static const char *level_name(level_t level);
+
+    private:
+
+    static sink_t _sink;
+    static void *_ctx;
+};
@@ -0,0 +1,108 @@
+#include "rxv1600logqueue.h"
+
+#include <string.h>
+
+
+RxV1600LogQueue::RxV1600LogQueue(cell_t *cells, size_t count, RxV1600Clock::millis_t clock) : _cells(cells),
+        _mask((uint32_t)count - 1), _millis(clock ? clock : RxV1600Clock::millis), _head(0), _tail(0) {
+    for( uint32_t i = 0; i < count; i++ ) {
+        _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    for( unsigned cls = 0; cls < CLASSES; cls++ ) {
+        rate_t &r = _rates[cls];
+        r.max = 0;
+        r.window_ms = 0;
+        r.start_ms.store(0, std::memory_order_relaxed);
+        r.count.store(0, std::memory_order_relaxed);
+        r.dropped.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+void RxV1600LogQueue::limit(unsigned cls, uint16_t max, uint32_t window_ms) {
+    if( cls >= CLASSES ) return;
+
+    rate_t &r = _rates[cls];
+    r.max = max;
+    r.window_ms = window_ms;
+    r.start_ms.store(_millis(), std::memory_order_relaxed);
+    r.count.store(0, std::memory_order_relaxed);
+}
+
+
+bool RxV1600LogQueue::admit(rate_t &rate) {
+    if( !rate.max ) return true;
+
+    uint32_t now = _millis();
+    uint32_t start = rate.start_ms.load(std::memory_order_relaxed);
+    if( now - start >= rate.window_ms && rate.start_ms.compare_exchange_strong(start, now, std::memory_order_relaxed) ) {
+        // this producer starts the next window
+        rate.count.store(0, std::memory_order_relaxed);
+    }
+    return rate.count.fetch_add(1, std::memory_order_relaxed) < rate.max;
+}
+
+
+bool RxV1600LogQueue::push(unsigned cls, const char *text) {
+    if( cls >= CLASSES ) cls = CLASSES - 1;
+    rate_t &rate = _rates[cls];
+
+    if( !admit(rate) ) {
+        rate.dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // claim the cell at head, if the consumer has freed it
+    uint32_t pos = _head.load(std::memory_order_relaxed);
+    cell_t *cell;
+    for( ;; ) {
+        cell = &_cells[pos & _mask];
+        int32_t diff = (int32_t)(cell->seq.load(std::memory_order_acquire) - pos);
+        if( diff == 0 ) {
+            if( _head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) ) break;
+        }
+        else if( diff < 0 ) {
+            // cell still holds a line of the previous round: full
+            rate.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else {
+            // another producer claimed it first
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->cls = (uint8_t)cls;
+    strncpy(cell->text, text, TEXT_MAX - 1);
+    cell->text[TEXT_MAX - 1] = '\0';
+    cell->seq.store(pos + 1, std::memory_order_release);  // publish to the consumer
+    return true;
+}
+
+
+bool RxV1600LogQueue::pop(unsigned &cls, char *text, size_t size) {
+    cell_t &cell = _cells[_tail & _mask];
+
+    if( cell.seq.load(std::memory_order_acquire) != _tail + 1 ) return false;  // empty or still being filled
+
+    cls = cell.cls;
+    if( size ) {
+        strncpy(text, cell.text, size - 1);
+        text[size - 1] = '\0';
+    }
+    cell.seq.store(_tail + _mask + 1, std::memory_order_release);  // free for the next round
+    _tail++;
+    return true;
+}
+
+
+uint32_t RxV1600LogQueue::dropped(unsigned cls) const {
+    return (cls < CLASSES) ? _rates[cls].dropped.load(std::memory_order_relaxed) : 0;
+}
+
+
+uint32_t RxV1600LogQueue::dropped() const {
+    uint32_t sum = 0;
+    for( unsigned cls = 0; cls < CLASSES; cls++ ) sum += dropped(cls);
+    return sum;
+}
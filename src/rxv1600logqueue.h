@@ -0,0 +1,85 @@
+#pragma once
+
+// Lock-free queue of log lines between any number of producers and one consumer
+// Producers, e.g. the main loop and web server callbacks, never block: a line is
+// dropped if the queue is full or its class exceeds its rate limit. A low priority
+// task drains the queue to slow outputs like Serial or syslog over UDP.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600clock.h>
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/// Class implementing a bounded MPSC queue of text lines in cells given by the owner
+/// Each cell carries a sequence number telling whether it is free or filled for the
+/// current round, so producers claim cells with one compare and swap.
+/// Lines belong to one of CLASSES classes, e.g. syslog priorities, each with its
+/// own rate limit and drop counter.
+class RxV1600LogQueue {
+    public:
+
+    static const size_t TEXT_MAX = 120;  // longer lines are truncated
+    static const unsigned CLASSES = 8;
+
+    typedef struct cell {
+        std::atomic<uint32_t> seq;  // cell is free if seq == position, filled if seq == position + 1
+        uint8_t cls;
+        char text[TEXT_MAX];
+    } cell_t;
+
+    /// @brief queue lines in cells of the owner
+    /// @param cells array of cells, must live as long as the queue
+    /// @param count number of cells, must be a power of 2
+    /// @param clock time source for rate limits, NULL for millis()
+    RxV1600LogQueue(cell_t *cells, size_t count, RxV1600Clock::millis_t clock = NULL);
+
+    /// @brief set rate limit of a class, not thread safe: call before pushing lines
+    /// @param cls class of lines
+    /// @param max lines accepted per window, 0 for no limit
+    /// @param window_ms length of the window
+    void limit(unsigned cls, uint16_t max, uint32_t window_ms);
+
+    /// @brief queue a line without blocking, from any task
+    /// @param cls class of the line, invalid classes are mapped to the last one
+    /// @param text the line
+    /// @return true if queued, false if dropped
+    bool push(unsigned cls, const char *text);
+
+    /// @brief get the oldest line, only from the one consumer task
+    /// @param cls receives the class of the line
+    /// @param text receives the line
+    /// @param size size of text
+    /// @return true if a line was returned, false if the queue is empty
+    bool pop(unsigned &cls, char *text, size_t size);
+
+    /// @brief get number of dropped lines of a class, because of the rate limit or a full queue
+    /// @param cls class of lines
+    /// @return lines dropped since construction
+    uint32_t dropped(unsigned cls) const;
+
+    /// @brief get number of dropped lines of all classes
+    /// @return lines dropped since construction
+    uint32_t dropped() const;
+
+    private:
+
+    typedef struct rate {
+        uint16_t max;
+        uint32_t window_ms;
+        std::atomic<uint32_t> start_ms;  // start of the current window
+        std::atomic<uint32_t> count;     // lines seen in the current window
+        std::atomic<uint32_t> dropped;
+    } rate_t;
+
+    bool admit(rate_t &rate);
+
+    cell_t *_cells;
+    uint32_t _mask;
+    RxV1600Clock::millis_t _millis;
+    std::atomic<uint32_t> _head;  // next position to claim by producers
+    uint32_t _tail;               // next position to read by the consumer
+    rate_t _rates[CLASSES];
+};
@@ -0,0 +1,140 @@
+#include "rxv1600metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+// snprintf length, limited to what fits into buf
+static size_t fitted( int len, size_t size ) {
+    if( len < 0 ) return 0;
+    return ((size_t)len < size) ? (size_t)len : size - 1;
+}
+
+
+RxV1600Metrics::RxV1600Metrics(const RxV1600Comm &comm, const char *labels, line_t extra, void *ctx) :
+        _reconciles(comm.reconciles()), _blocked_count(comm.blocked_count()), _blocked_ms(comm.blocked_ms()),
+        _link(comm.link()), _system(comm.system()), _labels(labels), _extra(extra), _ctx(ctx),
+        _line(0), _in_extra(false), _len(0), _pos(0) {
+    comm.metrics(_metrics);
+}
+
+
+size_t RxV1600Metrics::value_line(unsigned line, char *buf, size_t size, const char *name, const char *type, uint32_t value, const char *labels) {
+    int len;
+
+    switch( line ) {
+        case 0:
+            len = snprintf(buf, size, "# TYPE %s %s\n", name, type);
+            break;
+        case 1:
+            if( labels ) len = snprintf(buf, size, "%s{%s} %u\n", name, labels, (unsigned)value);
+            else len = snprintf(buf, size, "%s %u\n", name, (unsigned)value);
+            break;
+        default:
+            return 0;
+    }
+
+    return fitted(len, size);
+}
+
+
+size_t RxV1600Metrics::histogram_line(unsigned line, char *buf, size_t size, const char *name, const uint32_t *buckets, uint32_t sum, const char *labels) {
+    const char *sep = labels ? "," : "";
+    const unsigned n = RxV1600Comm::HIST_BUCKETS;
+    uint32_t count = 0;
+    int len;
+
+    if( line == 0 ) {
+        len = snprintf(buf, size, "# TYPE %s histogram\n", name);
+    }
+    else if( line <= n ) {
+        // cumulative count of bucket line - 1
+        unsigned index = line - 1;
+        for( unsigned i = 0; i <= index; i++ ) count += buckets[i];
+        if( index == n - 1 ) {
+            len = snprintf(buf, size, "%s_bucket{le=\"+Inf\"%s%s} %u\n", name, sep, labels ? labels : "", (unsigned)count);
+        }
+        else {
+            uint32_t le = RxV1600Comm::bucket_min(index + 1) - 1;  // largest value in the bucket
+            len = snprintf(buf, size, "%s_bucket{le=\"%u\"%s%s} %u\n", name, (unsigned)le, sep, labels ? labels : "", (unsigned)count);
+        }
+    }
+    else if( line == n + 1 ) {
+        if( labels ) len = snprintf(buf, size, "%s_sum{%s} %u\n", name, labels, (unsigned)sum);
+        else len = snprintf(buf, size, "%s_sum %u\n", name, (unsigned)sum);
+    }
+    else if( line == n + 2 ) {
+        for( unsigned i = 0; i < n; i++ ) count += buckets[i];
+        if( labels ) len = snprintf(buf, size, "%s_count{%s} %u\n", name, labels, (unsigned)count);
+        else len = snprintf(buf, size, "%s_count %u\n", name, (unsigned)count);
+    }
+    else {
+        return 0;
+    }
+
+    return fitted(len, size);
+}
+
+
+size_t RxV1600Metrics::comm_line( unsigned line, char *buf, size_t size ) const {
+    const struct {
+        const char *name;
+        const char *type;
+        uint32_t value;
+    } values[] = {
+        { "rxv1600_sent_total",        "counter", _metrics.sent },
+        { "rxv1600_retries_total",     "counter", _metrics.retries },
+        { "rxv1600_timeouts_total",    "counter", _metrics.timeouts },
+        { "rxv1600_frames_total",      "counter", _metrics.frames },
+        { "rxv1600_noise_bytes_total", "counter", _metrics.noise },
+        { "rxv1600_oversized_total",   "counter", _metrics.oversized },
+        { "rxv1600_rejected_total",    "counter", _metrics.rejected },
+        { "rxv1600_reconciles_total",  "counter", _reconciles },
+        { "rxv1600_blocked_total",     "counter", _blocked_count },
+        { "rxv1600_blocked_ms_total",  "counter", _blocked_ms },
+        { "rxv1600_link",              "gauge",   _link },    // 0 healthy, 1 degraded, 2 lost
+        { "rxv1600_system",            "gauge",   _system },  // System report value, 255 unknown
+    };
+    const unsigned count = sizeof(values) / sizeof(*values);
+
+    if( line < 2 * count ) {
+        return value_line(line % 2, buf, size, values[line / 2].name, values[line / 2].type, values[line / 2].value, _labels);
+    }
+    line -= 2 * count;
+
+    size_t len = histogram_line(line, buf, size, "rxv1600_latency_ms", _metrics.latency, _metrics.latency_sum, _labels);
+    if( len ) return len;
+    line -= HISTOGRAM_LINES;
+
+    return histogram_line(line, buf, size, "rxv1600_gap_ms", _metrics.gap, _metrics.gap_sum, _labels);
+}
+
+
+size_t RxV1600Metrics::read(uint8_t *dst, size_t len) {
+    size_t copied = 0;
+
+    while( copied < len ) {
+        if( _pos == _len ) {
+            // render next line
+            _pos = 0;
+            _len = _in_extra ? 0 : comm_line(_line, _buf, sizeof(_buf));
+            if( !_in_extra && !_len ) {
+                _in_extra = true;
+                _line = 0;
+            }
+            if( _in_extra && _extra ) {
+                _len = fitted((int)(*_extra)(_line, _buf, sizeof(_buf), _ctx), sizeof(_buf));
+            }
+            if( !_len ) break;  // done
+            _line++;
+        }
+
+        size_t n = _len - _pos;
+        if( n > len - copied ) n = len - copied;
+        memcpy(&dst[copied], &_buf[_pos], n);
+        _pos += n;
+        copied += n;
+    }
+
+    return copied;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+// Metrics of RxV1600Comm in the Prometheus text exposition format
+// The text is rendered line by line while it is read, so a web server can stream
+// it in chunks of any size without a buffer for the whole page.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600comm.h>
+
+
+/// Class to read the metrics of one RxV1600Comm as Prometheus text
+/// Values are copied on construction, so all chunks of one scrape are consistent.
+/// Programs add their own metrics with a line function, rendered after the comm metrics.
+class RxV1600Metrics {
+    public:
+
+    static const size_t LINE_MAX = 160;  // max length of one rendered line
+    static const unsigned HISTOGRAM_LINES = RxV1600Comm::HIST_BUCKETS + 3;  // TYPE, buckets, sum and count
+
+    /// @brief type of function rendering one line of additional metrics
+    /// @param line index of the line, starting at 0
+    /// @param buf receives the line including '\n'
+    /// @param size size of buf (LINE_MAX)
+    /// @param ctx context as given to the constructor
+    /// @return length of the line, 0 if there are no more lines
+    typedef size_t (* line_t)(unsigned line, char *buf, size_t size, void *ctx);
+
+    /// @brief take a snapshot of the metrics of a receiver
+    /// @param comm communication with the receiver
+    /// @param labels NULL or labels for all comm metrics, e.g. "receiver=\"rx1\""
+    /// @param extra NULL or function rendering additional metrics
+    /// @param ctx context to hand over to extra
+    RxV1600Metrics(const RxV1600Comm &comm, const char *labels = NULL, line_t extra = NULL, void *ctx = NULL);
+
+    /// @brief copy the next part of the text
+    /// @param dst destination buffer
+    /// @param len max bytes to copy
+    /// @return number of bytes copied, 0 at the end of the text
+    size_t read(uint8_t *dst, size_t len);
+
+    /// @brief render one line of a counter or gauge
+    /// @param line 0 for the TYPE line, 1 for the value line
+    /// @param buf receives the line
+    /// @param size size of buf
+    /// @param name metric name
+    /// @param type "counter" or "gauge"
+    /// @param value value of the metric
+    /// @param labels NULL or labels of the value
+    /// @return length of the line, 0 if line is beyond the metric
+    static size_t value_line(unsigned line, char *buf, size_t size, const char *name, const char *type, uint32_t value, const char *labels = NULL);
+
+    /// @brief render one line of a histogram with RxV1600Comm::bucket() buckets
+    /// @param line 0 for the TYPE line, then buckets, sum and count (HISTOGRAM_LINES in all)
+    /// @param buf receives the line
+    /// @param size size of buf
+    /// @param name metric name
+    /// @param buckets RxV1600Comm::HIST_BUCKETS counts
+    /// @param sum sum of all values
+    /// @param labels NULL or labels of the values
+    /// @return length of the line, 0 if line is beyond the histogram
+    static size_t histogram_line(unsigned line, char *buf, size_t size, const char *name, const uint32_t *buckets, uint32_t sum, const char *labels = NULL);
+
+    private:
+
+    size_t comm_line( unsigned line, char *buf, size_t size ) const;
+
+    RxV1600Comm::metrics_t _metrics;
+    uint32_t _reconciles;
+    uint32_t _blocked_count;
+    uint32_t _blocked_ms;
+    uint8_t _link;
+    uint8_t _system;
+    const char *_labels;
+    line_t _extra;
+    void *_ctx;
+    unsigned _line;        // next line to render
+    bool _in_extra;        // comm lines are done
+    char _buf[LINE_MAX];   // current line
+    size_t _len;           // length of current line
+    size_t _pos;           // bytes of current line already read
+};
@@ -0,0 +1,90 @@
+#include "rxv1600profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+RxV1600Profiler::RxV1600Profiler(const char *const *names, unsigned count, RxV1600Clock::micros_t clock) : _names(names),
+        _count(count < SLOTS_MAX ? count : SLOTS_MAX), _micros(clock ? clock : RxV1600Clock::micros) {
+    reset();
+}
+
+
+uint32_t RxV1600Profiler::begin() const {
+    return _micros();
+}
+
+
+void RxV1600Profiler::end(unsigned slot, uint32_t start_us) {
+    uint32_t now = _micros();
+
+    _elapsed_us += now - _last_us;
+    _last_us = now;
+
+    if( slot >= _count ) return;
+
+    slot_t &s = _slots[slot];
+    uint32_t us = now - start_us;
+    s.calls++;
+    if( us > s.max_us ) s.max_us = us;
+    s.hist[RxV1600Comm::bucket(us)]++;
+}
+
+
+unsigned RxV1600Profiler::slots() const {
+    return _count;
+}
+
+
+const char *RxV1600Profiler::name(unsigned slot) const {
+    return (slot < _count) ? _names[slot] : NULL;
+}
+
+
+const RxV1600Profiler::slot_t *RxV1600Profiler::get(unsigned slot) const {
+    return (slot < _count) ? &_slots[slot] : NULL;
+}
+
+
+uint32_t RxV1600Profiler::percentile(unsigned slot, unsigned pct) const {
+    if( slot >= _count || !_slots[slot].calls ) return 0;
+
+    const slot_t &s = _slots[slot];
+    uint64_t rank = ((uint64_t)s.calls * pct + 99) / 100;  // calls at or below the percentile
+    uint32_t count = 0;
+    for( unsigned i = 0; i < RxV1600Comm::HIST_BUCKETS - 1; i++ ) {
+        count += s.hist[i];
+        if( count >= rank ) {
+            uint32_t le = RxV1600Comm::bucket_min(i + 1) - 1;  // largest value in the bucket
+            return (le < s.max_us) ? le : s.max_us;
+        }
+    }
+    return s.max_us;
+}
+
+
+uint32_t RxV1600Profiler::rate(unsigned slot) const {
+    if( slot >= _count || !_elapsed_us ) return 0;
+
+    return (uint32_t)((uint64_t)_slots[slot].calls * 1000000 / _elapsed_us);
+}
+
+
+size_t RxV1600Profiler::json(unsigned slot, char *buf, size_t size) const {
+    if( slot >= _count || !size ) return 0;
+
+    const slot_t &s = _slots[slot];
+    int len = snprintf(buf, size, "{\"name\":\"%s\",\"calls\":%u,\"rate\":%u,\"p50_us\":%u,\"p99_us\":%u,\"max_us\":%u}",
+        _names[slot], (unsigned)s.calls, (unsigned)rate(slot), (unsigned)percentile(slot, 50),
+        (unsigned)percentile(slot, 99), (unsigned)s.max_us);
+
+    if( len < 0 ) return 0;
+    return ((size_t)len < size) ? (size_t)len : size - 1;
+}
+
+
+void RxV1600Profiler::reset() {
+    memset(_slots, 0, sizeof(_slots));
+    _last_us = _micros();
+    _elapsed_us = 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// Profiler for the handlers called by a main loop
+// Records calls, max and a log2 histogram of the duration of each handler in fixed memory.
+// Wrap handler calls with RXV_PROFILE(). Without RXV1600_PROFILE defined the macro is just
+// the call, so neither the profiler nor its overhead is needed in production builds.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600comm.h>
+
+
+#ifdef RXV1600_PROFILE
+#define RXV_PROFILE(profiler, slot, call) do { \
+        uint32_t rxv_start_us = (profiler).begin(); \
+        call; \
+        (profiler).end((slot), rxv_start_us); \
+    } while( 0 )
+#else
+#define RXV_PROFILE(profiler, slot, call) do { call; } while( 0 )
+#endif
+
+
+/// Class to measure the durations of up to SLOTS_MAX handlers
+/// Histograms use the buckets of RxV1600Comm::bucket() in µs.
+class RxV1600Profiler {
+    public:
+
+    static const unsigned SLOTS_MAX = 10;
+
+    typedef struct slot {
+        uint32_t calls;     // number of calls since reset
+        uint32_t max_us;    // longest call
+        uint32_t hist[RxV1600Comm::HIST_BUCKETS];  // durations in µs
+    } slot_t;
+
+    /// @brief profile handlers
+    /// @param names one name per slot, must live as long as the profiler
+    /// @param count number of slots, at most SLOTS_MAX
+    /// @param clock time source, NULL for micros(). Tests use a virtual clock
+    RxV1600Profiler(const char *const *names, unsigned count, RxV1600Clock::micros_t clock = NULL);
+
+    /// @brief start measuring a call
+    /// @return start time to hand over to end()
+    uint32_t begin() const;
+
+    /// @brief finish measuring a call
+    /// @param slot index of the handler
+    /// @param start_us value returned by begin()
+    void end(unsigned slot, uint32_t start_us);
+
+    /// @brief get number of slots
+    /// @return slots given to the constructor
+    unsigned slots() const;
+
+    /// @brief get name of a slot
+    /// @param slot index of the handler
+    /// @return name or NULL if slot is invalid
+    const char *name(unsigned slot) const;
+
+    /// @brief get measurements of a slot
+    /// @param slot index of the handler
+    /// @return measurements or NULL if slot is invalid
+    const slot_t *get(unsigned slot) const;
+
+    /// @brief estimate a percentile of the durations of a slot
+    /// @param slot index of the handler
+    /// @param pct percentile, e.g. 99
+    /// @return largest value of the bucket containing the percentile, or max_us for the last bucket
+    uint32_t percentile(unsigned slot, unsigned pct) const;
+
+    /// @brief get call rate of a slot since reset
+    /// @param slot index of the handler
+    /// @return calls per second, 0 if no time elapsed yet
+    uint32_t rate(unsigned slot) const;
+
+    /// @brief render the measurements of a slot as JSON object
+    /// e.g. {"name":"mqtt","calls":1200,"rate":40,"p50_us":63,"p99_us":1023,"max_us":1530}
+    /// @param slot index of the handler
+    /// @param buf receives the JSON
+    /// @param size size of buf
+    /// @return length of the JSON, 0 if slot is invalid
+    size_t json(unsigned slot, char *buf, size_t size) const;
+
+    /// @brief clear all measurements
+    void reset();
+
+    private:
+
+    const char *const *_names;
+    unsigned _count;
+    RxV1600Clock::micros_t _micros;
+    uint32_t _last_us;       // time of last end() or reset()
+    uint64_t _elapsed_us;    // time since reset() until last end(), survives wrap of micros
+    slot_t _slots[SLOTS_MAX];
+};
@@ -0,0 +1,105 @@
+#include "rxv1600scene.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+
+RxV1600Scene::RxV1600Scene(RxV1600Comm &comm, RxV1600 &rxv, const scene_t *scenes, size_t count) :
+        _comm(comm), _rxv(rxv), _scenes(scenes), _count(count), _scene(NULL), _step(NULL), _awake(false), _busy(false), _cb(NULL), _ctx(NULL) {
+}
+
+
+bool RxV1600Scene::start(const char *name) {
+    for( size_t i=0; i<_count; i++ ) {
+        if( strcmp(name, _scenes[i].name) == 0 ) {
+            _scene = &_scenes[i];
+            _step = _scene->steps;
+            enter(_comm.now());
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void RxV1600Scene::stop() {
+    _scene = NULL;
+    _step = NULL;
+}
+
+
+const char *RxV1600Scene::running() const {
+    return _scene ? _scene->name : NULL;
+}
+
+
+void RxV1600Scene::on_done(done_t cb, void *ctx) {
+    _cb = cb;
+    _ctx = ctx;
+}
+
+
+void RxV1600Scene::done( bool ok ) {
+    const char *name = _scene->name;
+
+    stop();
+    if( _cb ) {
+        (*_cb)(name, ok, _ctx);
+    }
+}
+
+
+void RxV1600Scene::enter( uint32_t now ) {
+    _step_ms = now;
+    uint8_t power = _rxv.report_value(0x20);
+    _awake = _step->op == S_READY && power != 0 && power != (uint8_t)RxV1600::UNKNOWN_VALUE;
+    _busy = false;
+}
+
+
+void RxV1600Scene::handle() {
+    while( _scene ) {
+        uint32_t now = _comm.now();
+        const char *cmd = NULL;
+        uint8_t value;
+
+        switch( _step->op ) {
+            case S_END:
+                done(true);
+                return;
+            case S_CMD:
+                cmd = RxV1600::command(_step->name);
+                break;
+            case S_SET:
+                cmd = RxV1600::command_value(_step->name, _step->id);
+                break;
+            case S_WAIT:
+                value = _rxv.report_value(_step->id);
+                if( value > 31 || !(_step->mask & RXV_BIT(value)) ) {
+                    // expected report not yet received
+                    if( now - _step_ms > _step->ms ) done(false);
+                    return;
+                }
+                break;
+            case S_DELAY:
+                if( now - _step_ms < _step->ms ) return;
+                break;
+            case S_READY:
+                if( _rxv.report_value(0x00) == RxV1600Comm::SYSTEM_BUSY ) _busy = true;
+                // continue on timeout: better late than never
+                if( !((_awake || _busy) && _rxv.ready(_step->id)) && now - _step_ms <= _step->ms ) return;
+                break;
+        }
+
+        if( _step->op == S_CMD || _step->op == S_SET ) {
+            if( !cmd ) {
+                done(false);  // unknown command in scene table
+                return;
+            }
+            if( !_comm.send(cmd) ) return;  // busy: try again next time
+        }
+
+        _step++;
+        enter(now);
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// Run named command sequences (scenes) on a Yamaha RX-V1600 AV Receiver
+// Steps send commands, wait for reports or delay. Scenes run non-blocking
+// from handle() and advance as soon as the receiver allows.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600.h>
+
+
+/// Class to run scenes from a constant scene table
+/// Commands of a scene are sent one after the other as soon as RxV1600Comm accepts them.
+/// Waits check the cached reports of RxV1600, so they end as soon as the receiver reports the
+/// expected value. A ready step continues as soon as the zone is on and the System is Ok, if some
+/// zone was already on when the step started: powering on another zone reports no Busy then.
+/// Otherwise it waits for the System report to go Busy and back to Ok while the zone is on, since
+/// an Ok cached from before power on does not mean the receiver accepts commands again.
+/// It continues anyway after its timeout.
+/// Only one scene runs at a time, starting a scene stops the running one.
+class RxV1600Scene {
+    public:
+
+    typedef enum op { S_END, S_CMD, S_SET, S_WAIT, S_DELAY, S_READY } op_t;
+
+    /// @brief one step of a scene, use the RXV_* macros to define them
+    /// 12 bytes on 32 bit targets like the ESP32, 16 on 64 bit hosts
+    typedef struct step {
+        uint8_t op;        // what to do, one of op_t
+        uint8_t id;        // S_WAIT: report id, S_SET: value, S_READY: zone
+        uint16_t ms;       // S_WAIT, S_READY: timeout, S_DELAY: delay
+        uint32_t mask;     // S_WAIT: accepted report values (bit n for value n)
+        const char *name;  // S_CMD, S_SET: command name
+    } step_t;
+
+    /// @brief a named scene, steps end with RXV_END
+    typedef struct scene {
+        const char *name;
+        const step_t *steps;
+    } scene_t;
+
+    /// @brief type of function called when a scene is done
+    /// @param name name of the scene
+    /// @param ok false if a command was unknown or a wait timed out
+    /// @param ctx context as given when the callback was registered
+    typedef void (* done_t)(const char *name, bool ok, void *ctx);
+
+    /// @brief run scenes on an RX-V1600
+    /// @param comm communication used to send the commands
+    /// @param rxv decoder with the cached reports to wait for
+    /// @param scenes table of scenes (usually const, i.e. in flash)
+    /// @param count number of scenes in the table
+    RxV1600Scene(RxV1600Comm &comm, RxV1600 &rxv, const scene_t *scenes, size_t count);
+
+    /// @brief start a scene from the table
+    /// @param name name of the scene
+    /// @return true if the scene exists
+    bool start(const char *name);
+
+    /// @brief stop the running scene without callback
+    void stop();
+
+    /// @brief get the running scene
+    /// @return name of the running scene or NULL if idle
+    const char *running() const;
+
+    /// @brief register a function that is called once a scene is done
+    /// @param cb the callback function
+    /// @param ctx context to hand over to the callback
+    void on_done(done_t cb, void *ctx);
+
+    /// @brief advance the running scene as far as possible
+    /// Call this regularly, e.g. after RxV1600Comm::handle()
+    void handle();
+
+    private:
+
+    void done( bool ok );  // end the scene and invoke callback
+    void enter( uint32_t now );  // start the current step
+
+    RxV1600Comm &_comm;
+    RxV1600 &_rxv;
+    const scene_t *_scenes;
+    size_t _count;
+    const scene_t *_scene;  // running scene or NULL
+    const step_t *_step;    // current step of running scene
+    uint32_t _step_ms;      // start of current step
+    bool _awake;            // S_READY: some zone was on at the start of the step, no Busy follows
+    bool _busy;             // S_READY: System Busy seen since the start of the step
+    done_t _cb;
+    void *_ctx;
+};
+
+
+// Step definitions for compact scene tables
+#define RXV_BIT(value)                 (1UL << (value))
+#define RXV_CMD(name)                  { RxV1600Scene::S_CMD, 0, 0, 0, name }
+#define RXV_SET(name, value)           { RxV1600Scene::S_SET, value, 0, 0, name }
+#define RXV_WAIT(id, mask, timeout_ms) { RxV1600Scene::S_WAIT, id, timeout_ms, mask, NULL }
+#define RXV_DELAY(ms)                  { RxV1600Scene::S_DELAY, 0, ms, 0, NULL }
+#define RXV_READY(zone, timeout_ms)    { RxV1600Scene::S_READY, zone, timeout_ms, 0, NULL }
+#define RXV_END                        { RxV1600Scene::S_END, 0, 0, 0, NULL }
@@ -0,0 +1,264 @@
+#pragma once
+
+// Command and report tables of a Yamaha RX-V1600 AV Receiver as X-macros
+// Each list takes two macros, FIRST for the first entry and NEXT for all others, so
+// code generating separated lists (like the JSON catalog) needs no trailing separator.
+// The tables are expanded into lookup maps and the catalog in rxv1600.cpp.
+// Based on RX-V1600_V2600_RS232C_ST.pdf
+// Joachim Banzhaf, 2023
+
+#include <rxv1600comm.h>
+
+
+/// Commands without value: FIRST/NEXT(name, bytes)
+#define RXV1600_COMMANDS(FIRST, NEXT) \
+    /* Init communication and request current configuration */ \
+    FIRST("Ready",                DC1 "000" ETX)              \
+                                                               \
+    /* Reset config to factory defaults */                     \
+    NEXT("ResetConfig",           DC3 DEL DEL DEL ETX)         \
+                                                               \
+    /* Operation commands (same as IR commands) */             \
+    NEXT("MainVolume_Up",         STX "07A1A" ETX)             \
+    NEXT("MainVolume_Down",       STX "07A1B" ETX)             \
+                                                               \
+    NEXT("Mute_On",               STX "07EA2" ETX)             \
+    NEXT("Mute_20dB",             STX "07EDF" ETX)             \
+    NEXT("Mute_Off",              STX "07EA3" ETX)             \
+                                                               \
+    NEXT("Input_Phono",           STX "07A14" ETX)             \
+    NEXT("Input_Cd",              STX "07A15" ETX)             \
+    NEXT("Input_Tuner",           STX "07A16" ETX)             \
+    NEXT("Input_CD-R",            STX "07A19" ETX)             \
+    NEXT("Input_MD-Tape",         STX "07A18" ETX)             \
+    NEXT("Input_Dvd",             STX "07AC1" ETX)             \
+    NEXT("Input_Dtv",             STX "07A54" ETX)             \
+    NEXT("Input_Cbl-Sat",         STX "07AC0" ETX)             \
+    NEXT("Input_Vcr1",            STX "07A0F" ETX)             \
+    NEXT("Input_Dvr-Vcr2",        STX "07A13" ETX)             \
+    NEXT("Input_V-Aux",           STX "07A55" ETX)             \
+                                                               \
+    NEXT("Zone2Volume_Up",        STX "07ADA" ETX)             \
+    NEXT("Zone2Volume_Down",      STX "07ADB" ETX)             \
+                                                               \
+    NEXT("Zone2Mute_On",          STX "07EA0" ETX)             \
+    NEXT("Zone2Mute_Off",         STX "07EA1" ETX)             \
+                                                               \
+    NEXT("Zone2Input_Phono",      STX "07AD0" ETX)             \
+    NEXT("Zone2Input_Cd",         STX "07AD1" ETX)             \
+    NEXT("Zone2Input_Tuner",      STX "07AD2" ETX)             \
+    NEXT("Zone2Input_CD-R",       STX "07AD4" ETX)             \
+    NEXT("Zone2Input_MD-Tape",    STX "07AD3" ETX)             \
+    NEXT("Zone2Input_Dvd",        STX "07ACD" ETX)             \
+    NEXT("Zone2Input_Dtv",        STX "07AD9" ETX)             \
+    NEXT("Zone2Input_Cbl-Sat",    STX "07ACC" ETX)             \
+    NEXT("Zone2Input_Vcr1",       STX "07AD6" ETX)             \
+    NEXT("Zone2Input_Dvr-Vcr2",   STX "07AD7" ETX)             \
+    NEXT("Zone2Input_V-Aux",      STX "07AD8" ETX)             \
+                                                               \
+    NEXT("AllZonePower_On",       STX "07A1D" ETX)             \
+    NEXT("AllZonePower_Off",      STX "07A1E" ETX)             \
+                                                               \
+    NEXT("MainZonePower_On",      STX "07E7E" ETX)             \
+    NEXT("MainZonePower_Off",     STX "07E7F" ETX)             \
+                                                               \
+    NEXT("Zone2ZonePower_On",     STX "07EBA" ETX)             \
+    NEXT("Zone2ZonePower_Off",    STX "07EBB" ETX)             \
+                                                               \
+    NEXT("Zone3ZonePower_On",     STX "07AED" ETX)             \
+    NEXT("Zone3ZonePower_Off",    STX "07AEE" ETX)             \
+                                                               \
+    NEXT("Zone3Mute_On",          STX "07E26" ETX)             \
+    NEXT("Zone3Mute_Off",         STX "07E66" ETX)             \
+                                                               \
+    NEXT("Zone3Volume_Up",        STX "07AFD" ETX)             \
+    NEXT("Zone3Volume_Down",      STX "07AFE" ETX)             \
+                                                               \
+    NEXT("Zone3Input_Phono",      STX "07AF1" ETX)             \
+    NEXT("Zone3Input_Cd",         STX "07AF2" ETX)             \
+    NEXT("Zone3Input_Tuner",      STX "07AF3" ETX)             \
+    NEXT("Zone3Input_CD-R",       STX "07AF5" ETX)             \
+    NEXT("Zone3Input_MD-Tape",    STX "07AF4" ETX)             \
+    NEXT("Zone3Input_Dvd",        STX "07AFC" ETX)             \
+    NEXT("Zone3Input_Dtv",        STX "07AF6" ETX)             \
+    NEXT("Zone3Input_Cbl-Sat",    STX "07AF7" ETX)             \
+    NEXT("Zone3Input_Vcr1",       STX "07AF9" ETX)             \
+    NEXT("Zone3Input_Dvr-Vcr2",   STX "07AFA" ETX)             \
+    NEXT("Zone3Input_V-Aux",      STX "07AF0" ETX)             \
+                                                               \
+    NEXT("NightListening_Off",    STX "07E9C" ETX)             \
+    NEXT("NightListening_Cinema", STX "07E9B" ETX)             \
+    NEXT("NightListening_Music",  STX "07ECF" ETX)             \
+                                                               \
+    /* probably mutually exclusive */                          \
+    NEXT("Effect",                STX "07E27" ETX)             \
+    NEXT("Straight",              STX "07EE0" ETX)             \
+                                                               \
+    NEXT("DSP_Vienna",            STX "07EE5" ETX)             \
+    NEXT("DSP_TheBottomLine",     STX "07EEC" ETX)             \
+    NEXT("DSP_TheRoxyTheatre",    STX "07EED" ETX)             \
+    NEXT("DSP_Disco",             STX "07EF0" ETX)             \
+    NEXT("DSP_Game",              STX "07EF2" ETX)             \
+    NEXT("DSP_7chStereo",         STX "07EFF" ETX)             \
+    NEXT("DSP_2chStereo",         STX "07EC0" ETX)             \
+    NEXT("DSP_Pop-Rock",          STX "07EF3" ETX)             \
+    NEXT("DSP_MonoMovie",         STX "07EF7" ETX)             \
+    NEXT("DSP_TvSports",          STX "07EF8" ETX)             \
+    NEXT("DSP_Spectacle",         STX "07EF9" ETX)             \
+    NEXT("DSP_SciFi",             STX "07EFA" ETX)             \
+    NEXT("DSP_Adventure",         STX "07EFB" ETX)             \
+    NEXT("DSP_General",           STX "07EFC" ETX)             \
+    NEXT("DSP_Standard",          STX "07EFD" ETX)             \
+    NEXT("DSP_Enhanced",          STX "07EFE" ETX)             \
+    NEXT("DSP_ThxCinema",         STX "07EC2" ETX)             \
+    NEXT("DSP_ThxMusic",          STX "07EC3" ETX)             \
+    NEXT("DSP_ThxGame",           STX "07EC8" ETX)             \
+                                                               \
+    NEXT("SpeakerRelayA_On",      STX "07EAB" ETX)             \
+    NEXT("SpeakerRelayA_Off",     STX "07EAC" ETX)             \
+                                                               \
+    NEXT("SpeakerRelayB_On",      STX "07EAD" ETX)             \
+    NEXT("SpeakerRelayB_Off",     STX "07EAE" ETX)             \
+                                                               \
+    NEXT("2ChDecoder_PliixMovie", STX "07E67" ETX)             \
+    NEXT("2ChDecoder_PliixMusic", STX "07E68" ETX)             \
+    NEXT("2ChDecoder_Neo6Cinema", STX "07E69" ETX)             \
+    NEXT("2ChDecoder_Neo6Music",  STX "07E6A" ETX)             \
+    NEXT("2ChDecoder_PliixGame",  STX "07EC7" ETX)             \
+    NEXT("2ChDecoder_ProLogic",   STX "07EC9" ETX)             \
+                                                               \
+    NEXT("Zone2Tone_BassUp",      STX "07A73" ETX)             \
+    NEXT("Zone2Tone_BassDown",    STX "07A74" ETX)             \
+    NEXT("Zone2Tone_TrebleUp",    STX "07A75" ETX)             \
+    NEXT("Zone2Tone_TrebleDown",  STX "07A76" ETX)             \
+                                                               \
+    NEXT("Zone3Tone_BassUp",      STX "07A77" ETX)             \
+    NEXT("Zone3Tone_BassDown",    STX "07A78" ETX)             \
+    NEXT("Zone3Tone_TrebleUp",    STX "07A79" ETX)             \
+    NEXT("Zone3Tone_TrebleDown",  STX "07A7A" ETX)             \
+                                                               \
+    /* System commands */                                      \
+    NEXT("ReportCommandCode_Enable",  STX "20000" ETX)         \
+    NEXT("ReportCommandCode_Disable", STX "20001" ETX)         \
+                                                               \
+    NEXT("ReportCommandDelay_0",      STX "20100" ETX)         \
+    NEXT("ReportCommandDelay_50",     STX "20101" ETX)         \
+    NEXT("ReportCommandDelay_100",    STX "20102" ETX)         \
+    NEXT("ReportCommandDelay_150",    STX "20103" ETX)         \
+    NEXT("ReportCommandDelay_200",    STX "20104" ETX)         \
+    NEXT("ReportCommandDelay_250",    STX "20105" ETX)         \
+    NEXT("ReportCommandDelay_300",    STX "20106" ETX)         \
+    NEXT("ReportCommandDelay_350",    STX "20107" ETX)         \
+    NEXT("ReportCommandDelay_400",    STX "20108" ETX)         \
+                                                               \
+    NEXT("OsdMessageStart",           STX "21000" ETX)         \
+    NEXT("TuningFrequencyText",       STX "22000" ETX)         \
+    NEXT("MainVolumeText",            STX "22001" ETX)         \
+    NEXT("Zone2VolumeText",           STX "22002" ETX)         \
+    NEXT("MainInputText",             STX "22003" ETX)         \
+    NEXT("Zone2InputText",            STX "22004" ETX)         \
+    NEXT("Zone3VolumeText",           STX "22005" ETX)         \
+    NEXT("Zone3InputText",            STX "22006" ETX)         \
+    NEXT("FirmwareVersion",           STX "22F00" ETX)         \
+                                                               \
+    NEXT("Dimmer_4",                  STX "22610" ETX)         \
+    NEXT("Dimmer_3",                  STX "22611" ETX)         \
+    NEXT("Dimmer_2",                  STX "22612" ETX)         \
+    NEXT("Dimmer_1",                  STX "22613" ETX)         \
+    NEXT("Dimmer_Off",                STX "22614" ETX)         \
+                                                               \
+    NEXT("MultiChannel_6Ch",          STX "27B00" ETX)         \
+    NEXT("MultiChannel_8ChTuner",     STX "27B01" ETX)         \
+    NEXT("MultiChannel_8ChCd",        STX "27B02" ETX)         \
+    NEXT("MultiChannel_8ChCd-R",      STX "27B03" ETX)         \
+    NEXT("MultiChannel_8ChMd-Tape",   STX "27B04" ETX)         \
+    NEXT("MultiChannel_8ChDvd",       STX "27B05" ETX)         \
+    NEXT("MultiChannel_8ChDtv",       STX "27B06" ETX)         \
+    NEXT("MultiChannel_8ChCblSat",    STX "27B07" ETX)         \
+    NEXT("MultiChannel_8ChVcr1",      STX "27B09" ETX)         \
+    NEXT("MultiChannel_8ChDvr-Vcr2",  STX "27B0A" ETX)         \
+    NEXT("MultiChannel_8ChV-Aux",     STX "27B0C" ETX)         \
+                                                               \
+    NEXT("NightMode_Off",             STX "28B00" ETX)         \
+    NEXT("NightMode_CinemaLow",       STX "28B10" ETX)         \
+    NEXT("NightMode_CinemaMid",       STX "28B11" ETX)         \
+    NEXT("NightMode_CinemaHigh",      STX "28B12" ETX)         \
+    NEXT("NightMode_MusicLow",        STX "28B20" ETX)         \
+    NEXT("NightMode_MusicMid",        STX "28B21" ETX)         \
+    NEXT("NightMode_MusicHigh",       STX "28B22" ETX)         \
+                                                               \
+    NEXT("WakeOnRs232C_Off",          STX "2BD00" ETX)         \
+    NEXT("WakeOnRs232C_On",           STX "2BD01" ETX)
+
+
+/// Commands with a value: FIRST/NEXT(name, printf format of the bytes, min value, max value)
+/// Values are decimal, so they can be stringized into the catalog. Volumes are -80 to 16.5 dB.
+#define RXV1600_VALUE_COMMANDS(FIRST, NEXT) \
+    /* System commands with values */                              \
+    FIRST("MainVolumeSet",            STX "230%02X" ETX, 39, 232) \
+    NEXT("Zone2VolumeSet",            STX "231%02X" ETX, 39, 232)  \
+    NEXT("Zone3VolumeSet",            STX "234%02X" ETX, 39, 232)
+
+
+/// Reports: FIRST/NEXT(id, name)
+#define RXV1600_REPORTS(FIRST, NEXT) \
+    FIRST(0x00, "System")                     \
+    NEXT(0x01, "Warning")                     \
+                                              \
+    NEXT(0x10, "Playback")                    \
+    NEXT(0x11, "Fs") /* sampling frequency */ \
+    NEXT(0x12, "ExEs")                        \
+    NEXT(0x13, "ThrBypass")                   \
+    NEXT(0x14, "Red-Dts")                     \
+    NEXT(0x15, "TunerTuned")                  \
+    NEXT(0x16, "Dts96-24")                    \
+                                              \
+    NEXT(0x20, "Power")                       \
+    NEXT(0x21, "Input")                       \
+    NEXT(0x22, "AudioMode")                   \
+    NEXT(0x23, "AudioMute")                   \
+    NEXT(0x24, "Zone2Input")                  \
+    NEXT(0x25, "Zone2Mute")                   \
+    NEXT(0x26, "MainVolume")                  \
+    NEXT(0x27, "Zone2Volume")                 \
+    NEXT(0x28, "Program")                     \
+    NEXT(0x29, "TunerPage")                   \
+    NEXT(0x2A, "PresetNo")                    \
+    NEXT(0x2B, "Osd")                         \
+    NEXT(0x2C, "Sleep")                       \
+    NEXT(0x2D, "ExtendedSurround")            \
+    NEXT(0x2E, "SpeakerRelayA")               \
+    NEXT(0x2F, "SpeakerRelayB")               \
+                                              \
+    NEXT(0x34, "Headphone")                   \
+    NEXT(0x35, "TunerBand")                   \
+    NEXT(0x3D, "SpeakerBZone")                \
+                                              \
+    NEXT(0x4B, "Zone2Bass")                   \
+    NEXT(0x4C, "Zone2Treble")                 \
+    NEXT(0x4D, "Zone3Bass")                   \
+    NEXT(0x4E, "Zone3Treble")                 \
+                                              \
+    NEXT(0x5F, "DecoderSelect")               \
+                                              \
+    NEXT(0x60, "AudioSelect")                 \
+    NEXT(0x61, "Dimmer")                      \
+    NEXT(0x6E, "2ChDecoder")                  \
+                                              \
+    NEXT(0x7B, "MultiChannel")                \
+                                              \
+    NEXT(0x8B, "NightMode")                   \
+    NEXT(0x8C, "PureDirect")                  \
+                                              \
+    NEXT(0xA0, "Zone3Input")                  \
+    NEXT(0xA1, "Zone3Mute")                   \
+    NEXT(0xA2, "Zone3Volume")                 \
+    NEXT(0xA5, "MuteType")                    \
+    NEXT(0xA7, "EqualizerType")               \
+    NEXT(0xA8, "ToneBypass")                  \
+                                              \
+    NEXT(0xB2, "FanControl")                  \
+    NEXT(0xB3, "SpeakerImpedance")            \
+    NEXT(0xB9, "RemoteSensor")                \
+    NEXT(0xBB, "Bi-Amp")                      \
+    NEXT(0xBD, "WakeOnRs232")
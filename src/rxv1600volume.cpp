@@ -0,0 +1,245 @@
+#include "rxv1600volume.h"
+
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+
+const uint8_t RxV1600Volume::MIN_VALUE = 0x27;
+const uint8_t RxV1600Volume::MAX_VALUE = 0xE8;
+const uint32_t RxV1600Volume::SETTLE_MS = 1000;
+const uint32_t RxV1600Volume::RAMP_INTERVAL_MS = 250;
+
+
+static const struct {
+    uint8_t id;        // volume report id
+    const char *set;   // absolute volume command
+    const char *up;    // relative volume commands
+    const char *down;
+    const char *ramp;  // pseudo command for timed ramps
+} ZONES[RxV1600Volume::Z_COUNT] = {
+    { 0x26, "MainVolumeSet",  "MainVolume_Up",  "MainVolume_Down",  "MainVolumeRamp" },
+    { 0x27, "Zone2VolumeSet", "Zone2Volume_Up", "Zone2Volume_Down", "Zone2VolumeRamp" },
+    { 0xA2, "Zone3VolumeSet", "Zone3Volume_Up", "Zone3Volume_Down", "Zone3VolumeRamp" }
+};
+
+
+RxV1600Volume::RxV1600Volume(RxV1600Comm &comm, RxV1600 &rxv) : _comm(comm), _rxv(rxv),
+        _interval_ms(RAMP_INTERVAL_MS) {
+    for( int z=0; z<Z_COUNT; z++ ) {
+        _target[z] = -1;
+        _sent[z] = 0;
+        _sent_ms[z] = 0;
+        _ramp[z].start_ms = 0;
+        _ramp[z].then = NULL;
+    }
+}
+
+
+uint8_t RxV1600Volume::clamp( int value ) {
+    if( value < MIN_VALUE ) return MIN_VALUE;
+    if( value > MAX_VALUE ) return MAX_VALUE;
+    return value;
+}
+
+
+int RxV1600Volume::base( zone_t zone ) {
+    if( _target[zone] >= 0 ) {
+        // stack on top of the not yet sent target
+        return _target[zone];
+    }
+
+    if( _sent_ms[zone] && _comm.now() - _sent_ms[zone] < SETTLE_MS ) {
+        // report of the last sent target is probably not yet received
+        return _sent[zone];
+    }
+
+    uint8_t value = _rxv.report_value(ZONES[zone].id);
+    return (value == (uint8_t)RxV1600::UNKNOWN_VALUE) ? -1 : value;
+}
+
+
+bool RxV1600Volume::step(zone_t zone, int steps) {
+    cancel(zone);
+
+    int value = base(zone);
+    if( value < 0 ) return false;
+
+    if( value < MIN_VALUE ) {
+        // volume is Infinite: stepping down is a noop, stepping up starts from lowest
+        if( steps <= 0 ) return true;
+        value = MIN_VALUE - 1;
+    }
+
+    _target[zone] = clamp(value + steps);
+    return true;
+}
+
+
+void RxV1600Volume::set(zone_t zone, uint8_t value) {
+    cancel(zone);
+    _target[zone] = value ? clamp(value) : 0;  // 0 is Infinite, i.e. muted
+}
+
+
+bool RxV1600Volume::command(const char *name) {
+    for( int z=0; z<Z_COUNT; z++ ) {
+        if( strcmp(name, ZONES[z].up) == 0 ) {
+            return step((zone_t)z, 1);
+        }
+        if( strcmp(name, ZONES[z].down) == 0 ) {
+            return step((zone_t)z, -1);
+        }
+    }
+    return false;
+}
+
+
+bool RxV1600Volume::command_value(const char *name, uint8_t value) {
+    for( int z=0; z<Z_COUNT; z++ ) {
+        if( strcmp(name, ZONES[z].set) == 0 ) {
+            set((zone_t)z, value);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool RxV1600Volume::ramp(zone_t zone, uint8_t value, uint32_t duration_ms, curve_t curve, const char *then) {
+    const char *cmd = then ? RxV1600::command(then) : NULL;
+    if( curve >= C_UNKNOWN || (then && !cmd) ) return false;
+
+    int from = base(zone);
+    if( from < 0 ) return false;
+
+    uint32_t now = _comm.now();
+    ramp_t &r = _ramp[zone];
+    r.start_ms = (now - 1) | 1;
+    r.duration_ms = duration_ms;
+    r.step_ms = now - _interval_ms;  // first step right away
+    r.from = clamp(from);            // fade in from Infinite starts at lowest volume
+    r.to = value ? clamp(value) : 0;
+    r.curve = curve;
+    r.then = cmd;
+    return true;
+}
+
+
+void RxV1600Volume::cancel() {
+    for( int z=0; z<Z_COUNT; z++ ) {
+        cancel((zone_t)z);
+    }
+}
+
+
+void RxV1600Volume::cancel(zone_t zone) {
+    _ramp[zone].start_ms = 0;
+    _ramp[zone].then = NULL;
+}
+
+
+bool RxV1600Volume::ramping(zone_t zone) const {
+    return _ramp[zone].start_ms != 0;
+}
+
+
+void RxV1600Volume::ramp_interval(uint32_t interval_ms) {
+    _interval_ms = interval_ms;
+}
+
+
+bool RxV1600Volume::ramp_zone(const char *name, zone_t &zone) {
+    for( int z=0; z<Z_COUNT; z++ ) {
+        if( strcmp(name, ZONES[z].ramp) == 0 ) {
+            zone = (zone_t)z;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+RxV1600Volume::curve_t RxV1600Volume::ramp_curve(const char *name) {
+    static const char *names[C_UNKNOWN] = { "linear", "in", "out", "smooth" };
+
+    for( int c=0; c<C_UNKNOWN; c++ ) {
+        if( strcasecmp(name, names[c]) == 0 ) return (curve_t)c;
+    }
+    return C_UNKNOWN;
+}
+
+
+bool RxV1600Volume::pending(zone_t zone) const {
+    return _target[zone] >= 0;
+}
+
+
+void RxV1600Volume::handle_ramp( zone_t zone, uint32_t now ) {
+    ramp_t &r = _ramp[zone];
+
+    if( now - r.step_ms < _interval_ms ) return;
+    r.step_ms = now;
+
+    uint32_t elapsed = now - r.start_ms;
+    if( elapsed >= r.duration_ms ) {
+        // done: exact end value, the follow up command (if any) is sent after it
+        _target[zone] = r.to;
+        r.start_ms = 0;
+        return;
+    }
+
+    float t = (float)elapsed / r.duration_ms;
+    switch( r.curve ) {
+        case C_EASE_IN:  t = t * t; break;
+        case C_EASE_OUT: t = t * (2 - t); break;
+        case C_SMOOTH:   t = t * t * (3 - 2 * t); break;
+        default: break;
+    }
+
+    int to = r.to ? r.to : MIN_VALUE;  // fade out to Infinite steps down to lowest volume first
+    _target[zone] = clamp(r.from + lroundf((to - r.from) * t));
+}
+
+
+void RxV1600Volume::handle() {
+    uint32_t now = _comm.now();
+
+    for( int z=0; z<Z_COUNT; z++ ) {
+        if( _sent_ms[z] && now - _sent_ms[z] >= SETTLE_MS ) {
+            _sent_ms[z] = 0;  // from now on use reported volume as base
+        }
+        if( _ramp[z].start_ms ) {
+            handle_ramp((zone_t)z, now);
+        }
+    }
+
+    for( int z=0; z<Z_COUNT; z++ ) {
+        if( _target[z] < 0 ) continue;
+
+        if( !_sent_ms[z] && _target[z] == _rxv.report_value(ZONES[z].id) ) {
+            // receiver already has this volume
+            _target[z] = -1;
+            continue;
+        }
+
+        if( _comm.send(RxV1600::command_value(ZONES[z].set, _target[z])) ) {
+            _sent[z] = _target[z];
+            _sent_ms[z] = (now - 1) | 1;
+            _target[z] = -1;
+        }
+        return;  // one command per call, communication is busy now anyway
+    }
+
+    // all targets sent: now the commands that follow finished ramps
+    for( int z=0; z<Z_COUNT; z++ ) {
+        ramp_t &r = _ramp[z];
+        if( r.start_ms || !r.then ) continue;
+
+        if( _comm.send(r.then) ) {
+            r.then = NULL;
+        }
+        return;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+// Coalesce volume requests for a Yamaha RX-V1600 AV Receiver
+// Bursts of relative up/down steps and absolute slider positions are merged
+// into one absolute MainVolumeSet, Zone2VolumeSet or Zone3VolumeSet command.
+// Timed ramps (fade in, fade out, sleep) feed the same pending target.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600.h>
+
+
+/// Class to collapse volume requests into absolute volume set commands
+/// Each zone has at most one pending target. New requests replace it, so
+/// superseded targets are never sent. The pending target is sent during handle()
+/// as soon as RxV1600Comm accepts a new command.
+/// A ramp moves the target along a curve in steps of at least the ramp interval,
+/// so it never sends faster than the receiver accepts commands.
+class RxV1600Volume {
+    public:
+
+    typedef enum zone { Z_MAIN, Z_ZONE2, Z_ZONE3, Z_COUNT } zone_t;
+    typedef enum curve { C_LINEAR, C_EASE_IN, C_EASE_OUT, C_SMOOTH, C_UNKNOWN } curve_t;
+
+    static const uint8_t MIN_VALUE;   // lowest settable volume (-80 dB)
+    static const uint8_t MAX_VALUE;   // highest settable volume (16.5 dB)
+    static const uint32_t SETTLE_MS;  // how long a sent target is the base for further steps
+    static const uint32_t RAMP_INTERVAL_MS;  // default time between two ramp steps
+
+    /// @brief coalesce volume commands for an RX-V1600
+    /// @param comm communication used to send the volume set commands
+    /// @param rxv decoder with the cached volume reports of the receiver
+    RxV1600Volume(RxV1600Comm &comm, RxV1600 &rxv);
+
+    /// @brief change volume of a zone relative to the newest known target, cancels a ramp of the zone
+    /// @param zone zone to change
+    /// @param steps number of 0.5 dB steps, negative to decrease
+    /// @return true if the volume of the zone is known and a target was set
+    bool step(zone_t zone, int steps);
+
+    /// @brief set absolute volume of a zone, cancels a ramp of the zone
+    /// @param zone zone to change
+    /// @param value raw volume value as in volume reports (0xC7 = 0 dB)
+    void set(zone_t zone, uint8_t value);
+
+    /// @brief coalesce a volume up or down command
+    /// @param name camel cased command name from spec, e.g. "MainVolume_Up"
+    /// @return true if name is a volume step command and was coalesced,
+    ///         false if not or the volume is not yet known (send the relative command instead)
+    bool command(const char *name);
+
+    /// @brief coalesce a volume set command
+    /// @param name camel cased command name from spec, e.g. "MainVolumeSet"
+    /// @param value raw volume value as in volume reports
+    /// @return true if name is a volume set command and was coalesced
+    bool command_value(const char *name, uint8_t value);
+
+    /// @brief start a timed volume ramp from the newest known target
+    /// @param zone zone to ramp
+    /// @param value raw volume value to reach at the end of the ramp
+    /// @param duration_ms how long the ramp takes
+    /// @param curve shape of the ramp in dB over time
+    /// @param then command name to send once the ramp is done (e.g. "MainZonePower_Off") or NULL
+    /// @return true if the volume of the zone is known and the ramp was started
+    bool ramp(zone_t zone, uint8_t value, uint32_t duration_ms, curve_t curve = C_LINEAR, const char *then = NULL);
+
+    /// @brief stop ramps, the volume stays at the last ramp step and the follow up command is dropped
+    void cancel();
+    void cancel(zone_t zone);
+
+    /// @brief check if a zone is ramping
+    /// @param zone zone to check
+    /// @return true if a ramp is active
+    bool ramping(zone_t zone) const;
+
+    /// @brief set minimum time between two ramp steps
+    /// @param interval_ms time in ms, default RAMP_INTERVAL_MS
+    void ramp_interval(uint32_t interval_ms);
+
+    /// @brief get zone of a volume ramp command name
+    /// @param name ramp command name, e.g. "MainVolumeRamp"
+    /// @param zone receives the zone of the ramp command
+    /// @return true if name is a ramp command
+    static bool ramp_zone(const char *name, zone_t &zone);
+
+    /// @brief get curve by name
+    /// @param name one of "linear", "in", "out" or "smooth"
+    /// @return curve or C_UNKNOWN
+    static curve_t ramp_curve(const char *name);
+
+    /// @brief check if a zone has a target that is not yet sent
+    /// @param zone zone to check
+    /// @return true if a target is pending
+    bool pending(zone_t zone) const;
+
+    /// @brief send the newest pending target if the communication is free
+    /// Call this regularly, e.g. after RxV1600Comm::handle()
+    void handle();
+
+    private:
+
+    static uint8_t clamp( int value );
+    int base( zone_t zone );                 // newest known volume or -1
+    void handle_ramp( zone_t zone, uint32_t now );
+
+    typedef struct ramp_state {
+        uint32_t start_ms;     // start of the ramp or 0 if inactive
+        uint32_t duration_ms;  // length of the ramp
+        uint32_t step_ms;      // time of last step
+        uint8_t from;          // start volume
+        uint8_t to;            // end volume
+        curve_t curve;         // shape of the ramp
+        const char *then;      // command bytes to send after the ramp, kept until sent
+    } ramp_t;
+
+    RxV1600Comm &_comm;
+    RxV1600 &_rxv;
+    int16_t _target[Z_COUNT];    // pending volume per zone or -1 if none
+    uint8_t _sent[Z_COUNT];      // last volume sent per zone
+    uint32_t _sent_ms[Z_COUNT];  // when _sent was sent or 0 if not recently
+    ramp_t _ramp[Z_COUNT];       // active ramps
+    uint32_t _interval_ms;       // minimum time between ramp steps
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+// Diagnostic web pages of the ESP32 gateways for a Yamaha RX-V1600 AV Receiver
+// Command catalog, Prometheus metrics with ESP32 health, handler profile and traffic capture
+// download for an ESPAsyncWebServer. Header only, so the library itself builds without the
+// web server: only programs including this header need ESPAsyncWebServer and the ESP32 core.
+// Joachim Banzhaf, 2023
+
+#include <rxv1600.h>
+#include <rxv1600capture.h>
+#include <rxv1600logqueue.h>
+#include <rxv1600metrics.h>
+#include <rxv1600profiler.h>
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <rom/rtc.h>
+
+#include <memory>
+
+
+/// Class to register the diagnostic pages of a gateway
+/// The objects handed over must live as long as the web server.
+class RxV1600Web {
+    public:
+
+    /// @brief gateway health for /metrics, updated by the gateway
+    typedef struct health {
+        uint32_t wifi_reconnects;
+        uint32_t mqtt_connects;
+        uint32_t mqtt_publish_failures;
+        uint32_t loop_us[RxV1600Comm::HIST_BUCKETS];  // histogram of loop iteration times
+        uint32_t loop_us_sum;
+        const RxV1600LogQueue *log_queue;  // NULL or queue of the dropped log lines
+    } health_t;
+
+    /// @brief get the description of the reason of the last reset of a core
+    /// @param core 0 or 1
+    /// @return constant string
+    static const char *reset_reason(int core);
+
+    /// @brief render one line of the gateway metrics, a RxV1600Metrics::line_t
+    /// @param line index of the line, starting at 0
+    /// @param buf receives the line
+    /// @param size size of buf
+    /// @param ctx the health_t of the gateway
+    /// @return length of the line, 0 if there are no more lines
+    static size_t health_line(unsigned line, char *buf, size_t size, void *ctx);
+
+    /// @brief serve the command catalog at /commands
+    /// @param server web server
+    /// @param etag quoted firmware version, the catalog only changes with it
+    static void commands(AsyncWebServer &server, const char *etag);
+
+    /// @brief serve the comm metrics and the gateway health at /metrics
+    /// @param server web server
+    /// @param comm communication with the receiver
+    /// @param health gateway health
+    static void metrics(AsyncWebServer &server, const RxV1600Comm &comm, health_t &health);
+
+    /// @brief serve the handler durations at /profile
+    /// @param server web server
+    /// @param profiler profiler of the loop handlers
+    static void profile(AsyncWebServer &server, const RxV1600Profiler &profiler);
+
+    /// @brief serve the traffic capture at /capture, recording pauses until the download is done
+    /// @param server web server
+    /// @param capture capture recorded by the comm
+    static void capture(AsyncWebServer &server, RxV1600Capture &capture);
+};
+
+
+inline const char *RxV1600Web::reset_reason(int core) {
+    switch( rtc_get_reset_reason(core) ) {
+        case 1  : return "Vbat power on reset";
+        case 3  : return "Software reset digital core";
+        case 4  : return "Legacy watch dog reset digital core";
+        case 5  : return "Deep Sleep reset digital core";
+        case 6  : return "Reset by SLC module, reset digital core";
+        case 7  : return "Timer Group0 Watch dog reset digital core";
+        case 8  : return "Timer Group1 Watch dog reset digital core";
+        case 9  : return "RTC Watch dog Reset digital core";
+        case 10 : return "Instrusion tested to reset CPU";
+        case 11 : return "Time Group reset CPU";
+        case 12 : return "Software reset CPU";
+        case 13 : return "RTC Watch dog Reset CPU";
+        case 14 : return "for APP CPU, reseted by PRO CPU";
+        case 15 : return "Reset when the vdd voltage is not stable";
+        case 16 : return "RTC Watch dog reset digital core and rtc module";
+        default : return "Reset reason unknown";
+    }
+}
+
+
+inline size_t RxV1600Web::health_line(unsigned line, char *buf, size_t size, void *ctx) {
+    const health_t &h = *(const health_t *)ctx;
+    const struct {
+        const char *name;
+        const char *type;
+        uint32_t value;
+    } values[] = {
+        { "esp_heap_free_bytes",         "gauge",   ESP.getFreeHeap() },
+        { "esp_heap_min_free_bytes",     "gauge",   ESP.getMinFreeHeap() },  // low water mark since boot
+        { "esp_uptime_seconds",          "counter", millis() / 1000 },
+        { "wifi_reconnects_total",       "counter", h.wifi_reconnects },
+        { "mqtt_connects_total",         "counter", h.mqtt_connects },
+        { "mqtt_publish_failures_total", "counter", h.mqtt_publish_failures },
+        { "log_dropped_total",           "counter", h.log_queue ? h.log_queue->dropped() : 0 },
+    };
+    const unsigned count = sizeof(values) / sizeof(*values);
+
+    if( line < 2 * count ) {
+        return RxV1600Metrics::value_line(line % 2, buf, size, values[line / 2].name, values[line / 2].type, values[line / 2].value);
+    }
+    line -= 2 * count;
+
+    if( line < RxV1600Metrics::HISTOGRAM_LINES ) {
+        return RxV1600Metrics::histogram_line(line, buf, size, "esp_loop_us", h.loop_us, h.loop_us_sum);
+    }
+    line -= RxV1600Metrics::HISTOGRAM_LINES;
+
+    if( line == 0 ) {
+        return snprintf(buf, size, "# TYPE esp_reset_reason gauge\n");
+    }
+    if( line <= 2 ) {
+        // raw reset reason of each core, labeled with its description
+        int core = line - 1;
+        return snprintf(buf, size, "esp_reset_reason{core=\"%d\",reason=\"%s\"} %d\n", core, reset_reason(core), (int)rtc_get_reset_reason(core));
+    }
+
+    return 0;
+}
+
+
+inline void RxV1600Web::commands(AsyncWebServer &server, const char *etag) {
+    server.on("/commands", HTTP_GET, [etag](AsyncWebServerRequest *request) {
+        if( request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag ) {
+            request->send(304);
+            return;
+        }
+        AsyncWebServerResponse *response = request->beginResponse_P(200, "application/json",
+            (const uint8_t *)RxV1600::catalog(), RxV1600::catalog_length());
+        response->addHeader("Cache-Control", "public, max-age=86400");
+        response->addHeader("ETag", etag);
+        request->send(response);
+    });
+}
+
+
+inline void RxV1600Web::metrics(AsyncWebServer &server, const RxV1600Comm &comm, health_t &health) {
+    // rendered line by line while the response is sent
+    server.on("/metrics", HTTP_GET, [&comm, &health](AsyncWebServerRequest *request) {
+        std::shared_ptr<RxV1600Metrics> metrics = std::make_shared<RxV1600Metrics>(comm, nullptr, health_line, &health);
+        request->send(request->beginChunkedResponse("text/plain; version=0.0.4",
+            [metrics](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return metrics->read(buffer, maxLen);
+            }));
+    });
+}
+
+
+inline void RxV1600Web::profile(AsyncWebServer &server, const RxV1600Profiler &profiler) {
+    server.on("/profile", HTTP_GET, [&profiler](AsyncWebServerRequest *request) {
+        AsyncResponseStream *response = request->beginResponseStream("application/json");
+        char buf[160];
+        response->print("[");
+        for( unsigned slot = 0; slot < profiler.slots(); slot++ ) {
+            profiler.json(slot, buf, sizeof(buf));
+            response->printf("%s%s", slot ? "," : "", buf);
+        }
+        response->print("]");
+        request->send(response);
+    });
+}
+
+
+inline void RxV1600Web::capture(AsyncWebServer &server, RxV1600Capture &capture) {
+    // only one download at a time, a second one would unpause the first
+    server.on("/capture", HTTP_GET, [&capture](AsyncWebServerRequest *request) {
+        if( capture.pause(true) ) {
+            request->send(409, "text/plain", "Capture download already running");
+            return;
+        }
+        AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", capture.size(),
+            [&capture](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                size_t len = capture.read(index, buffer, maxLen);
+                if( !len ) capture.pause(false);
+                return len;
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=\"rxv1600.cap\"");
+        request->onDisconnect([&capture]() { capture.pause(false); });
+        request->send(response);
+    });
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Scripted serial port and virtual clock for host tests
+
+#include <Stream.h>
+
+#include <deque>
+#include <string>
+
+
+/// Stream that returns queued input and records output
+class MockStream : public Stream {
+    public:
+
+    int available() override { return (int)in.size(); }
+    int peek() override { return in.empty() ? -1 : (uint8_t)in.front(); }
+    int read() override {
+        if( in.empty() ) return -1;
+        int ch = (uint8_t)in.front();
+        in.pop_front();
+        return ch;
+    }
+    size_t write(uint8_t ch) override { out += (char)ch; return 1; }
+
+    /// @brief queue chars the receiver sends
+    void receive(const std::string &str) { in.insert(in.end(), str.begin(), str.end()); }
+
+    std::deque<char> in;  // chars to be read
+    std::string out;      // chars written
+};
+
+
+/// Virtual time for RxV1600Comm, advanced by the tests only
+struct VirtualClock {
+    static inline uint32_t ms = 0;
+    static uint32_t millis() { return ms; }
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+// Minimal test helpers: each test is a function, failed checks are counted and reported
+
+#include <stdio.h>
+
+
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+        if( !(cond) ) { \
+            fprintf(stderr, "%s:%d: %s: check failed: %s\n", __FILE__, __LINE__, __func__, #cond); \
+            test_failures++; \
+        } \
+    } while( 0 )
+
+#define RUN(test) do { \
+        int failures = test_failures; \
+        test(); \
+        printf("%s %s\n", failures == test_failures ? "ok  " : "FAIL", #test); \
+    } while( 0 )
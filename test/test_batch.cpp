@@ -0,0 +1,133 @@
+// Host tests of RxV1600Batch
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600batch.h>
+
+#include <string>
+#include <vector>
+
+
+// all commands of a payload as strings
+static std::vector<std::string> items( const char *payload ) {
+    std::vector<std::string> result;
+    RxV1600Batch::cursor_t cur;
+    RxV1600Batch::span_t item;
+
+    RxV1600Batch::begin(cur, payload, strlen(payload));
+    while( RxV1600Batch::next(cur, item) ) {
+        result.push_back(std::string(item.str, item.len));
+    }
+    if( cur.error ) result.push_back("<error>");
+    return result;
+}
+
+
+static void test_parse() {
+    typedef std::vector<std::string> v;
+
+    CHECK(items("MainZonePower_On") == v({ "MainZonePower_On" }));
+    CHECK(items(" Input_Dtv ;\r\n\nMainVolumeSet, 0x80\n") == v({ "Input_Dtv", "MainVolumeSet, 0x80" }));
+    CHECK(items("[ \"Input_Dtv\", \"MainVolumeSet,0x80\" ]") == v({ "Input_Dtv", "MainVolumeSet,0x80" }));
+    CHECK(items("[]").empty() && items("").empty() && items(" ;\n").empty());
+
+    // not well formed JSON stops at the error
+    CHECK(items("[\"Input_Dtv\"") == v({ "<error>" }));
+    CHECK(items("[\"Input_Dtv\",]") == v({ "<error>" }));
+    CHECK(items("[\"Input_Dtv\" \"Input_Tuner\"]") == v({ "<error>" }));
+    CHECK(items("[\"Input\\u0041\"]") == v({ "<error>" }));
+    CHECK(items("[\"Input_Dtv\"] x") == v({ "Input_Dtv", "<error>" }));
+
+    // fields of a command do not need a copy of the payload
+    const char payload[] = "MainVolumeSet , 0x80";
+    RxV1600Batch::span_t rest = { payload, sizeof(payload) - 1 }, field;
+    CHECK(RxV1600Batch::split(rest, field) && field.str == payload && field.len == 13);
+    CHECK(RxV1600Batch::split(rest, field) && field.str == &payload[16] && field.len == 4);
+    CHECK(!rest.str && !RxV1600Batch::split(rest, field));
+}
+
+
+static void test_resolve() {
+    char cmd[8];
+    RxV1600Batch::span_t item;
+    const struct {
+        const char *item;
+        RxV1600Batch::error_t error;
+    } cases[] = {
+        { "MainVolumeSet,0x80",      RxV1600Batch::E_OK },
+        { "MainVolumeSet,128",       RxV1600Batch::E_OK },
+        { "MainVolumeSet,0x100",     RxV1600Batch::E_VALUE },
+        { "MainVolumeSet,12x",       RxV1600Batch::E_VALUE },
+        { "MainVolumeSet,",          RxV1600Batch::E_VALUE },
+        { "MainVolumeSet,1,2",       RxV1600Batch::E_SYNTAX },
+        { ",1",                      RxV1600Batch::E_SYNTAX },
+        { "NoSuchCommand",           RxV1600Batch::E_UNKNOWN },
+        { "Input_Dtv,1",             RxV1600Batch::E_UNKNOWN },
+        { "AVeryLongNameThatCannotBeACommand", RxV1600Batch::E_UNKNOWN },
+    };
+
+    for( auto &c : cases ) {
+        item = { c.item, strlen(c.item) };
+        CHECK(RxV1600Batch::resolve(item, cmd) == c.error);
+    }
+
+    item = { "MainVolumeSet,0x80", 18 };
+    CHECK(RxV1600Batch::resolve(item, cmd) == RxV1600Batch::E_OK && strcmp(cmd, STX "23080" ETX) == 0);
+    item = { "Input_Dtv", 9 };
+    CHECK(RxV1600Batch::resolve(item, cmd) == RxV1600Batch::E_OK && strcmp(cmd, RxV1600::command("Input_Dtv")) == 0);
+}
+
+
+static void test_submit() {
+    MockStream stream;
+    RxV1600Comm comm(stream, VirtualClock::millis);
+    RxV1600Batch batch(comm);
+    unsigned failed = 99;
+
+    VirtualClock::ms = 1000;
+
+    // one invalid command rejects the whole batch
+    CHECK(batch.submit("Input_Dtv\nNoSuchCommand\nMainZonePower_On", 40, &failed) == RxV1600Batch::E_UNKNOWN);
+    CHECK(failed == 1 && batch.pending() == 0);
+    CHECK(batch.submit("[\"Input_Dtv\"", 12, &failed) == RxV1600Batch::E_SYNTAX && failed == 0);
+    CHECK(batch.submit(" \n", 2) == RxV1600Batch::E_EMPTY);
+
+    // payload need not be null terminated
+    const char payload[] = "[\"MainZonePower_On\",\"Input_Dtv\",\"MainVolumeSet,0x80\"]garbage";
+    CHECK(batch.submit(payload, sizeof(payload) - 8) == RxV1600Batch::E_OK);
+    CHECK(batch.pending() == 3);
+
+    // commands are sent in order, each after the previous got its response
+    std::string expected = std::string(RxV1600::command("MainZonePower_On")) + RxV1600::command("Input_Dtv") + STX "23080" ETX;
+    for( unsigned i = 0; i < 3; i++ ) {
+        batch.handle();
+        VirtualClock::ms += 100;  // after the gap of the last response
+        comm.handle();
+        batch.handle();  // rejected, command still active
+        stream.receive(STX "002001" ETX);
+        comm.handle();
+    }
+    CHECK(stream.out == expected && batch.pending() == 0);
+
+    // batches are queued completely or not at all
+    std::string many;
+    for( unsigned i = 0; i < RxV1600Batch::CMDS_MAX - 1; i++ ) many += "Input_Dtv;";
+    CHECK(batch.submit(many.c_str(), many.size()) == RxV1600Batch::E_OK);
+    CHECK(batch.submit("Input_Dtv;Input_Dtv", 19, &failed) == RxV1600Batch::E_FULL && failed == 1);
+    CHECK(batch.pending() == RxV1600Batch::CMDS_MAX - 1);
+    CHECK(batch.submit("Input_Tuner", 11) == RxV1600Batch::E_OK && batch.pending() == RxV1600Batch::CMDS_MAX);
+
+    batch.cancel();
+    CHECK(batch.pending() == 0);
+    CHECK(strcmp(RxV1600Batch::error_name(RxV1600Batch::E_FULL), "queue full") == 0);
+}
+
+
+int main() {
+    RUN(test_parse);
+    RUN(test_resolve);
+    RUN(test_submit);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+// Host tests of RxV1600Capture and the recording by RxV1600Comm
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600emu.h>
+
+#include <string>
+#include <vector>
+
+
+static uint32_t clock_us = 0;
+static uint32_t virtual_micros() { return clock_us; }
+
+
+struct Record {
+    RxV1600Capture::dir_t dir;
+    uint32_t us;
+    std::string frame;
+};
+
+
+// download a capture in small chunks and parse it
+static std::vector<Record> download( const RxV1600Capture &cap, size_t chunk = 5 ) {
+    std::vector<uint8_t> data(cap.size());
+    size_t len, offset = 0;
+    while( (len = cap.read(offset, &data[offset], chunk)) > 0 ) offset += len;
+    CHECK(offset == cap.size());
+
+    std::vector<Record> records;
+    size_t pos = 0;
+    RxV1600Capture::dir_t dir;
+    uint32_t us;
+    const char *frame;
+    while( RxV1600Capture::parse(data.data(), data.size(), pos, dir, us, frame, len) ) {
+        records.push_back({ dir, us, std::string(frame, len) });
+    }
+    CHECK(pos == data.size());
+    return records;
+}
+
+
+static void test_record() {
+    uint8_t buf[64];
+    RxV1600Capture cap(buf, sizeof(buf), virtual_micros);
+
+    CHECK(cap.size() == sizeof(RxV1600Capture::MAGIC));
+    CHECK(download(cap).empty());
+
+    clock_us = 0x12345678;
+    cap.record(RxV1600Capture::D_SENT, "abc", 3);
+    clock_us += 1000;
+    cap.record(RxV1600Capture::D_ERROR, "", 0);
+
+    std::vector<Record> recs = download(cap);
+    CHECK(recs.size() == 2);
+    CHECK(recs[0].dir == RxV1600Capture::D_SENT && recs[0].us == 0x12345678 && recs[0].frame == "abc");
+    CHECK(recs[1].dir == RxV1600Capture::D_ERROR && recs[1].us == 0x12345678 + 1000 && recs[1].frame.empty());
+}
+
+
+static void test_wrap() {
+    uint8_t buf[40];  // room for 3 records of 7 chars
+    RxV1600Capture cap(buf, sizeof(buf), virtual_micros);
+
+    for( unsigned i = 0; i < 10; i++ ) {
+        std::string frame = "frame-" + std::to_string(i);
+        cap.record(RxV1600Capture::D_RECV, frame.c_str(), frame.size());
+    }
+    CHECK(cap.records() == 10 && cap.dropped() == 7);
+
+    std::vector<Record> recs = download(cap);
+    CHECK(recs.size() == 3);
+    CHECK(recs.front().frame == "frame-7" && recs.back().frame == "frame-9");
+
+    cap.record(RxV1600Capture::D_RECV, (const char *)buf, sizeof(buf));  // too long for the buffer
+    CHECK(download(cap).size() == 3);
+
+    CHECK(!cap.pause(true));
+    CHECK(cap.pause(true));  // a second download is refused
+    cap.record(RxV1600Capture::D_RECV, "x", 1);
+    CHECK(cap.records() == 10);
+    cap.clear();
+    CHECK(download(cap).empty());
+}
+
+
+static void test_parse_invalid() {
+    static const uint8_t bad_magic[] = "RXVCAP0\n";
+    static const uint8_t truncated[] = "RXVCAP1\n" "\x01\x08" "\0\0\0\0" "\x02" "0026";
+    size_t pos = 0, len;
+    RxV1600Capture::dir_t dir;
+    uint32_t us;
+    const char *frame;
+
+    CHECK(!RxV1600Capture::parse(bad_magic, sizeof(bad_magic) - 1, pos, dir, us, frame, len));
+    pos = 0;
+    CHECK(!RxV1600Capture::parse(truncated, sizeof(truncated) - 1, pos, dir, us, frame, len));
+}
+
+
+static void test_comm() {
+    RxV1600Emu emu(VirtualClock::millis);
+    RxV1600Comm comm(emu, VirtualClock::millis);
+    uint8_t buf[1024];
+    RxV1600Capture cap(buf, sizeof(buf), virtual_micros);
+
+    comm.capture(&cap);
+    comm.send(RxV1600::command("Ready"));
+    for( unsigned ms = 0; ms < 500; ms++ ) {
+        VirtualClock::ms++;
+        clock_us += 1000;
+        comm.handle();
+    }
+    comm.capture(NULL);
+    comm.send(RxV1600::command("MainVolume_Up"));
+    for( unsigned ms = 0; ms < 500; ms++ ) {
+        VirtualClock::ms++;
+        comm.handle();
+    }
+
+    std::vector<Record> recs = download(cap);
+    CHECK(recs.size() == 2);
+    CHECK(recs[0].dir == RxV1600Capture::D_SENT && recs[0].frame == RxV1600::command("Ready"));
+    CHECK(recs[1].dir == RxV1600Capture::D_RECV && recs[1].frame.size() == 157 && recs[1].frame[0] == *DC2);
+    CHECK(recs[1].us > recs[0].us);
+}
+
+
+int main() {
+    RUN(test_record);
+    RUN(test_wrap);
+    RUN(test_parse_invalid);
+    RUN(test_comm);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+// Host tests of RxV1600Coalescer
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600coalescer.h>
+
+#include <vector>
+
+
+struct Published {
+    uint8_t id;
+    uint8_t value;
+};
+
+
+struct Fixture {
+    Fixture( uint32_t window_ms ) : coalescer(rxv, window_ms, published, this, VirtualClock::millis) {
+        VirtualClock::ms = 1000;
+    }
+
+    static void published( uint8_t id, void *ctx ) {
+        Fixture &f = *(Fixture *)ctx;
+        f.pubs.push_back({ id, f.rxv.report_value(id) });
+    }
+
+    // decode a report with value and tell the coalescer
+    void report( uint8_t id, uint8_t value ) {
+        char resp[9];
+        uint8_t decoded;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+        snprintf(resp, sizeof(resp), STX "00%02X%02X" ETX, id, value);
+        CHECK(rxv.decode(resp, decoded, guard, origin));
+        coalescer.changed(decoded);
+    }
+
+    void advance( uint32_t ms ) {
+        while( ms-- ) {
+            VirtualClock::ms++;
+            coalescer.handle();
+        }
+    }
+
+    RxV1600 rxv;
+    RxV1600Coalescer coalescer;
+    std::vector<Published> pubs;
+};
+
+
+static void test_change_only() {
+    Fixture f(0);
+
+    f.report(0x26, 0xC7);
+    f.advance(1);
+    f.report(0x26, 0xC7);  // same value again
+    f.advance(1);
+    f.report(0x26, 0xC8);
+    f.advance(1);
+
+    CHECK(f.pubs.size() == 2);
+    CHECK(f.pubs[0].id == 0x26 && f.pubs[0].value == 0xC7);
+    CHECK(f.pubs[1].id == 0x26 && f.pubs[1].value == 0xC8);
+    CHECK(f.coalescer.suppressed() == 1);
+
+    f.report(0x20, 0x01);
+    f.advance(1);
+    f.coalescer.republish();
+    f.advance(1);
+    CHECK(f.pubs.size() == 5);
+    CHECK(f.pubs[3].id == 0x20 && f.pubs[4].id == 0x26 && f.pubs[4].value == 0xC8);
+    CHECK(f.coalescer.suppressed() == 1);
+}
+
+
+static void test_window() {
+    Fixture f(100);
+
+    // volume ramp: a step every 20 ms for 300 ms
+    for( unsigned step = 0; step < 15; step++ ) {
+        f.report(0x26, 0xA0 + step);
+        f.advance(20);
+    }
+    f.advance(100);
+
+    // one publish per window with the latest value, the last one with the final value
+    CHECK(f.pubs.size() == 3);
+    CHECK(f.pubs[0].value == 0xA0 + 4 && f.pubs[1].value == 0xA0 + 9);
+    CHECK(f.pubs.back().value == 0xA0 + 14);
+
+    // ids have independent windows, a change back within the window is not published
+    f.report(0x20, 0x01);
+    f.advance(50);
+    f.report(0x26, 0x00);
+    f.report(0x26, 0xA0 + 14);
+    f.advance(50);
+    CHECK(f.pubs.size() == 4 && f.pubs[3].id == 0x20);
+    f.advance(50);
+    CHECK(f.pubs.size() == 4);
+}
+
+
+int main() {
+    RUN(test_change_only);
+    RUN(test_window);
+
+    return test_failures ? 1 : 0;
+}
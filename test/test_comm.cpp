@@ -0,0 +1,405 @@
+// Host tests of RxV1600Comm timing and ordering, driven by a virtual clock
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600comm.h>
+#include <rxv1600log.h>
+
+#include <string>
+#include <vector>
+
+
+static const std::string CMD_A = STX "07A1A" ETX;      // MainVolume_Up
+static const std::string CMD_B = STX "07A1B" ETX;      // MainVolume_Down
+static const std::string CMD_C = STX "07EA2" ETX;      // Mute_On
+static const std::string READY = DC1 "000" ETX;
+static const std::string REPORT = STX "0026C7" ETX;    // MainVolume 0 dB
+static const std::string SYS_BUSY = STX "000001" ETX;  // System Busy
+static const std::string SYS_OK = STX "000000" ETX;    // System Ok
+static const uint32_t GAP = RxV1600Comm::GAP_MS + 2;  // gap has passed for sure
+static const std::string CONFIG = DC2 "R0161" "0A" "0000000" "000" ETX;  // minimal config response
+
+
+struct Fixture {
+    Fixture( uint32_t start_ms = 1000 ) : comm(stream, VirtualClock::millis) {
+        VirtualClock::ms = start_ms;
+        comm.on_recv(recvd, this);
+        comm.on_link(link_changed, this);
+    }
+
+    static void recvd( const char *resp, void *ctx ) {
+        Fixture &f = *(Fixture *)ctx;
+        if( resp ) {
+            f.resps.push_back(resp);
+            if( f.on_resp ) f.on_resp(f);
+        }
+        else {
+            f.timeouts++;
+        }
+    }
+
+    static void link_changed( RxV1600Comm::link_t link, void *ctx ) {
+        ((Fixture *)ctx)->links.push_back(link);
+    }
+
+    // advance virtual time in 1 ms steps and call handle() on each
+    void advance( uint32_t ms ) {
+        while( ms-- ) {
+            VirtualClock::ms++;
+            comm.handle();
+        }
+    }
+
+    // number of times cmd was written
+    size_t sent( const std::string &cmd ) const {
+        size_t n = 0;
+        for( size_t pos = stream.out.find(cmd); pos != std::string::npos; pos = stream.out.find(cmd, pos + 1) ) n++;
+        return n;
+    }
+
+    MockStream stream;
+    RxV1600Comm comm;
+    std::vector<std::string> resps;
+    std::vector<RxV1600Comm::link_t> links;
+    unsigned timeouts = 0;
+    void (*on_resp)(Fixture &f) = nullptr;
+};
+
+
+static void test_send_response() {
+    Fixture f;
+
+    CHECK(f.comm.send(CMD_A.c_str()));
+    CHECK(!f.comm.send(CMD_B.c_str()));  // one command at a time
+    f.comm.handle();
+    CHECK(f.stream.out == CMD_A);
+
+    f.stream.receive(REPORT);
+    f.comm.handle();
+    CHECK(f.resps.size() == 1 && f.resps[0] == REPORT);
+    CHECK(f.comm.send(CMD_B.c_str()));
+}
+
+
+static void test_retransmit( uint32_t start_ms ) {
+    Fixture f(start_ms);
+    uint32_t t0 = VirtualClock::ms;
+
+    f.comm.send(CMD_A.c_str());
+    f.comm.handle();
+    CHECK(f.sent(CMD_A) == 1);
+
+    for( unsigned tries = 2; tries <= RxV1600Comm::MAX_TRIES; tries++ ) {
+        f.advance(RxV1600Comm::TIMEOUT_MS);
+        CHECK(f.sent(CMD_A) == tries - 1);  // no retransmit exactly at timeout
+        f.advance(1);
+        CHECK(f.sent(CMD_A) == tries);
+    }
+    CHECK(f.links.size() == 1 && f.links[0] == RxV1600Comm::LINK_DEGRADED);
+
+    f.advance(RxV1600Comm::TIMEOUT_MS);
+    CHECK(f.timeouts == 0);
+    f.advance(1);
+    CHECK(f.timeouts == 1);
+    CHECK(f.sent(CMD_A) == RxV1600Comm::MAX_TRIES);
+    CHECK(VirtualClock::ms - t0 == RxV1600Comm::MAX_TRIES * (RxV1600Comm::TIMEOUT_MS + 1));
+    CHECK(f.comm.link() == RxV1600Comm::LINK_LOST);
+}
+
+
+static void test_retransmit_timing() {
+    test_retransmit(1000);
+}
+
+
+static void test_retransmit_wraparound() {
+    test_retransmit(0xFFFFFFFF - 2500);  // 32 bit millis wraps during the retries
+}
+
+
+static void test_gap( uint32_t start_ms ) {
+    Fixture f(start_ms);
+
+    f.stream.receive(REPORT);
+    f.comm.handle();  // received at start_ms
+    CHECK(f.comm.send(CMD_A.c_str()));
+    f.advance(RxV1600Comm::GAP_MS - 1);
+    CHECK(f.stream.out.empty());
+    f.advance(2);
+    CHECK(f.stream.out == CMD_A);
+}
+
+
+static void test_gap_enforced() {
+    test_gap(100);
+    test_gap(101);
+    test_gap(0xFFFFFFFF - RxV1600Comm::GAP_MS / 2);
+}
+
+
+static void test_not_sent_command_survives_reports() {
+    Fixture f;
+
+    f.stream.receive(REPORT);
+    f.comm.handle();
+    f.comm.send(CMD_A.c_str());
+    f.advance(10);
+    f.stream.receive(REPORT);  // unsolicited report before the command could be sent
+    f.advance(GAP);
+    CHECK(f.sent(CMD_A) == 1);
+}
+
+
+static void test_deferred_order() {
+    Fixture f;
+
+    f.on_resp = [](Fixture &f) {
+        if( f.resps.size() == 1 ) {
+            CHECK(f.comm.send(CMD_B.c_str()));  // from within callback: deferred
+            CHECK(f.comm.send(CMD_C.c_str()));
+        }
+    };
+
+    f.stream.receive(REPORT);
+    f.comm.handle();
+    CHECK(f.comm.deferred() == 1);         // B is active, C waits
+    CHECK(!f.comm.send(CMD_A.c_str()));  // later sends wait for the deferred lane
+
+    f.advance(GAP);
+    CHECK(f.stream.out == CMD_B);
+    f.stream.receive(REPORT);
+    f.advance(GAP);
+    CHECK(f.stream.out == CMD_B + CMD_C);
+    CHECK(f.comm.deferred() == 0);
+
+    f.stream.receive(REPORT);
+    f.advance(1);
+    CHECK(f.comm.send(CMD_A.c_str()));
+    f.advance(GAP);
+    CHECK(f.stream.out == CMD_B + CMD_C + CMD_A);
+}
+
+
+static void test_deferred_full() {
+    Fixture f;
+
+    f.on_resp = [](Fixture &f) {
+        for( unsigned i = 0; i < RxV1600Comm::DEFER_MAX; i++ ) {
+            CHECK(f.comm.send(CMD_A.c_str()));
+        }
+        CHECK(!f.comm.send(CMD_B.c_str()));
+    };
+
+    f.stream.receive(REPORT);
+    f.comm.handle();
+}
+
+
+static void test_busy_hold() {
+    Fixture f;
+
+    f.stream.receive(SYS_BUSY);
+    f.comm.handle();
+    CHECK(f.comm.system() == RxV1600Comm::SYSTEM_BUSY);
+    f.comm.send(CMD_A.c_str());
+    f.advance(500);
+    CHECK(f.stream.out.empty());
+    CHECK(f.comm.blocked_count() == 1);
+
+    f.stream.receive(SYS_OK);
+    f.advance(GAP);
+    CHECK(f.stream.out == CMD_A);
+    CHECK(f.comm.blocked_ms() >= 500);
+}
+
+
+static void test_busy_after_send() {
+    Fixture f;
+
+    // receiver gets busy right after the command went out
+    f.comm.send(CMD_A.c_str());
+    f.comm.handle();
+    CHECK(f.sent(CMD_A) == 1);
+    f.stream.receive(SYS_BUSY);
+    f.advance(500);
+    CHECK(f.sent(CMD_A) == 1);
+
+    // Ok releases the held command instead of answering it
+    f.stream.receive(SYS_OK);
+    f.comm.handle();
+    CHECK(f.sent(CMD_A) == 1);
+    f.advance(GAP);
+    CHECK(f.sent(CMD_A) == 2);
+    CHECK(f.comm.blocked_count() == 1);
+
+    // the real response ends the command
+    f.stream.receive(REPORT);
+    f.advance(2 * RxV1600Comm::TIMEOUT_MS);
+    CHECK(f.sent(CMD_A) == 2);
+}
+
+
+static void test_busy_repeated() {
+    Fixture f;
+
+    // receiver stays busy after the command went out and keeps reporting it
+    f.comm.send(CMD_A.c_str());
+    f.comm.handle();
+    for( uint32_t ms = 0; ms < RxV1600Comm::BUSY_MS + 2000; ms += 100 ) {
+        f.stream.receive(SYS_BUSY);
+        f.advance(100);
+    }
+
+    // the expired hold is not renewed: one more try, then a Busy report ends the command
+    CHECK(f.sent(CMD_A) == 2);
+    CHECK(f.comm.send(CMD_B.c_str()));
+}
+
+
+static void test_busy_expires() {
+    Fixture f;
+
+    f.stream.receive(SYS_BUSY);
+    f.comm.handle();
+    f.comm.send(CMD_A.c_str());
+    f.advance(RxV1600Comm::BUSY_MS - 1);
+    CHECK(f.stream.out.empty());
+    f.advance(1);
+    CHECK(f.stream.out == CMD_A);  // Ok report probably got lost
+}
+
+
+static void test_lost_probe_recover() {
+    Fixture f;
+
+    f.comm.send(CMD_A.c_str());
+    f.comm.handle();
+    f.advance(RxV1600Comm::MAX_TRIES * (RxV1600Comm::TIMEOUT_MS + 1));
+    CHECK(f.comm.link() == RxV1600Comm::LINK_LOST);
+    CHECK(!f.comm.send(CMD_B.c_str()));
+
+    f.advance(RxV1600Comm::PROBE_MIN_MS - 1);
+    CHECK(f.sent(READY) == 0);
+    f.advance(1);
+    CHECK(f.sent(READY) == 1);
+
+    // unanswered probe: no callback, next probe after doubled backoff
+    f.advance(RxV1600Comm::TIMEOUT_MS + 1);
+    CHECK(f.timeouts == 1);
+    f.advance(2 * RxV1600Comm::PROBE_MIN_MS - 1);
+    CHECK(f.sent(READY) == 1);
+    f.advance(1);
+    CHECK(f.sent(READY) == 2);
+
+    f.stream.receive(CONFIG);
+    f.comm.handle();
+    CHECK(f.comm.link() == RxV1600Comm::LINK_HEALTHY);
+    CHECK(f.resps.size() == 1 && f.resps[0] == CONFIG);
+    CHECK(f.comm.send(CMD_B.c_str()));
+}
+
+
+static void test_reconcile_when_idle() {
+    Fixture f;
+
+    f.comm.reconcile(60000);
+    for( int i = 0; i < 10; i++ ) {
+        f.stream.receive(REPORT);  // busy bus
+        f.advance(RxV1600Comm::IDLE_MS - 1);
+    }
+    f.advance(60000 - 10 * (RxV1600Comm::IDLE_MS - 1) - 1);
+    CHECK(f.sent(READY) == 0);
+    f.advance(1);
+    CHECK(f.sent(READY) == 1);
+    CHECK(f.comm.reconciles() == 1);
+
+    f.stream.receive(CONFIG);
+    f.advance(60000);
+    CHECK(f.sent(READY) == 1);  // interval restarts with the config response
+}
+
+
+static void test_metrics() {
+    Fixture f;
+    RxV1600Comm::metrics_t m;
+
+    CHECK(RxV1600Comm::bucket(0) == 0 && RxV1600Comm::bucket(1) == 1 && RxV1600Comm::bucket(30) == 5);
+    CHECK(RxV1600Comm::bucket(0xFFFFFFFF) == RxV1600Comm::HIST_BUCKETS - 1);
+    CHECK(RxV1600Comm::bucket_min(0) == 0 && RxV1600Comm::bucket_min(5) == 16);
+
+    CHECK(f.comm.send(CMD_A.c_str()));
+    CHECK(!f.comm.send(CMD_B.c_str()));
+    f.comm.handle();
+    f.advance(RxV1600Comm::TIMEOUT_MS + 1);  // one retry
+    f.advance(20);
+    f.stream.receive("xx" + REPORT);  // noise before the response
+    f.advance(1);
+    f.advance(100);
+    f.stream.receive(SYS_OK);
+    f.advance(1);
+
+    f.comm.metrics(m);
+    CHECK(m.sent == 2 && m.retries == 1 && m.timeouts == 0 && m.rejected == 1);
+    CHECK(m.frames == 2 && m.noise == 2 && m.oversized == 0);
+    CHECK(m.latency[RxV1600Comm::bucket(21)] == 1);
+    CHECK(m.gap[RxV1600Comm::bucket(101)] == 1);
+
+    f.stream.receive(STX + std::string(300, '0'));
+    f.advance(1);
+    f.comm.metrics(m);
+    CHECK(m.oversized == 1);
+
+    f.comm.reset_metrics();
+    f.comm.metrics(m);
+    CHECK(m.sent == 0 && m.frames == 0 && m.latency[RxV1600Comm::bucket(21)] == 0);
+}
+
+
+static void log_line( RxV1600Log::level_t level, const char *line, void *ctx ) {
+    ((std::vector<std::string> *)ctx)->push_back(std::string(RxV1600Log::level_name(level)) + " " + line);
+}
+
+
+static void test_log() {
+    Fixture f;
+    std::vector<std::string> lines;
+
+    RxV1600Log::sink(log_line, &lines);
+    f.comm.send(CMD_A.c_str());
+    f.comm.handle();
+    f.stream.receive(REPORT);
+    f.advance(1);
+    f.stream.receive(STX + std::string(300, '0'));
+    f.advance(1);
+    RxV1600Log::sink(NULL);
+    f.advance(GAP);
+
+    CHECK(lines.size() == 5);
+    CHECK(lines[0] == "D sent '" + CMD_A + "'");
+    CHECK(lines[1] == "D recv '" + REPORT + "'");
+    CHECK(lines[2] == "W discarded oversized response");
+    CHECK(lines[3] == "I link degraded");
+    CHECK(lines[4].compare(0, 8, "D recv '") == 0);  // the discarded part
+}
+
+
+int main() {
+    RUN(test_send_response);
+    RUN(test_retransmit_timing);
+    RUN(test_retransmit_wraparound);
+    RUN(test_gap_enforced);
+    RUN(test_not_sent_command_survives_reports);
+    RUN(test_deferred_order);
+    RUN(test_deferred_full);
+    RUN(test_busy_hold);
+    RUN(test_busy_after_send);
+    RUN(test_busy_repeated);
+    RUN(test_busy_expires);
+    RUN(test_lost_probe_recover);
+    RUN(test_reconcile_when_idle);
+    RUN(test_metrics);
+    RUN(test_log);
+
+    return test_failures ? 1 : 0;
+}
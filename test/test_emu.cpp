@@ -0,0 +1,155 @@
+// Host tests of RxV1600Comm and RxV1600 against the emulated receiver
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600emu.h>
+
+#include <string>
+#include <vector>
+
+
+struct Fixture {
+    Fixture() : emu(VirtualClock::millis), comm(emu, VirtualClock::millis) {
+        comm.on_recv(recvd, this);
+    }
+
+    static void recvd( const char *resp, void *ctx ) {
+        Fixture &f = *(Fixture *)ctx;
+        bool power;
+        uint8_t id;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+
+        if( !resp ) {
+            f.timeouts++;
+        }
+        else if( f.rxv.decodeConfig(resp, power) ) {
+            f.configs++;
+        }
+        else if( f.rxv.decode(resp, id, guard, origin) ) {
+            f.reports.push_back(id);
+            f.origin = origin;
+        }
+        else {
+            f.invalid++;
+        }
+    }
+
+    // send a command and handle communication for some time
+    void run( const char *cmd, uint32_t ms = 500 ) {
+        CHECK(cmd && comm.send(cmd));
+        advance(ms);
+    }
+
+    void advance( uint32_t ms ) {
+        while( ms-- ) {
+            VirtualClock::ms++;
+            comm.handle();
+        }
+    }
+
+    RxV1600Emu emu;
+    RxV1600Comm comm;
+    RxV1600 rxv;
+    std::vector<uint8_t> reports;
+    RxV1600::origin_t origin = RxV1600::O_UNKNOWN;
+    unsigned configs = 0;
+    unsigned timeouts = 0;
+    unsigned invalid = 0;
+};
+
+
+static void test_config() {
+    Fixture f;
+
+    f.emu.set(0x8B, 0x21);  // two digit value: Night Music Level Middle
+    f.run(RxV1600::command("Ready"));
+    CHECK(f.configs == 1);
+    for( uint8_t id : { 0x00, 0x20, 0x21, 0x26, 0x27, 0x28, 0x2E, 0x8B, 0xA2 } ) {
+        CHECK(f.rxv.report_value(id) == f.emu.get(id));
+    }
+    CHECK(f.rxv.ready(0));
+}
+
+
+static void test_operations() {
+    Fixture f;
+
+    f.run(RxV1600::command("MainVolume_Up"));
+    CHECK(f.reports.size() == 1 && f.reports[0] == 0x26);
+    CHECK(f.rxv.report_value(0x26) == 0xC8);
+    CHECK(f.origin == RxV1600::O_RS232C);
+
+    f.run(RxV1600::command("Input_Cbl-Sat"));
+    CHECK(f.rxv.report_value(0x21) == 0x07);
+    f.run(RxV1600::command("NightListening_Cinema"));
+    CHECK(f.rxv.report_value(0x8B) == 0x10);
+    f.run(RxV1600::command("SpeakerRelayA_Off"));
+    CHECK(f.rxv.report_value(0x2E) == 0x00);
+    f.run(RxV1600::command_value("Zone2VolumeSet", 0x80));
+    CHECK(f.rxv.report_value(0x27) == 0x80);
+    f.run(RxV1600::command("NightMode_MusicHigh"));
+    CHECK(f.rxv.report_value(0x8B) == 0x22);
+    CHECK(f.timeouts == 0 && f.invalid == 0);
+}
+
+
+static void test_power_on() {
+    Fixture f;
+
+    f.emu.set(0x20, 0);  // all off
+    f.run(RxV1600::command("MainZonePower_On"), 100);
+    CHECK(f.reports.size() == 2 && f.reports[0] == 0x00 && f.reports[1] == 0x20);
+    CHECK(f.comm.system() == RxV1600Comm::SYSTEM_BUSY);
+    CHECK(!f.rxv.ready(0));
+
+    f.advance(RxV1600Emu::POWER_ON_MS);
+    CHECK(f.comm.system() == RxV1600Comm::SYSTEM_OK);
+    CHECK(f.rxv.ready(0));
+}
+
+
+static void test_byte_timing() {
+    Fixture f;
+
+    // 7 chars command, response delay, 8 chars report
+    uint32_t min_ms = (7 * RxV1600Emu::BYTE_US + 8 * RxV1600Emu::BYTE_US) / 1000 + RxV1600Emu::RESPONSE_MS;
+    f.comm.send(RxV1600::command("MainVolume_Down"));
+    f.comm.handle();
+    f.advance(min_ms - 1);
+    CHECK(f.reports.empty());
+    f.advance(2);
+    CHECK(f.reports.size() == 1);
+}
+
+
+static void test_errors() {
+    Fixture f;
+
+    f.emu.errors(100, 0);
+    f.run(RxV1600::command("MainVolume_Up"), RxV1600Comm::MAX_TRIES * (RxV1600Comm::TIMEOUT_MS + 1) + 10);
+    CHECK(f.emu.commands() == RxV1600Comm::MAX_TRIES);
+    CHECK(f.timeouts == 1);
+    CHECK(f.comm.link() == RxV1600Comm::LINK_LOST);
+
+    f.emu.errors(0, 0);
+    f.advance(RxV1600Comm::PROBE_MIN_MS + 500);  // probe gets the config
+    CHECK(f.configs == 1);
+    CHECK(f.comm.link() == RxV1600Comm::LINK_HEALTHY);
+
+    f.emu.errors(0, 100);
+    f.run(RxV1600::command("MainVolume_Up"));  // garbled report
+    CHECK(f.invalid == 1);
+}
+
+
+int main() {
+    RUN(test_config);
+    RUN(test_operations);
+    RUN(test_power_on);
+    RUN(test_byte_timing);
+    RUN(test_errors);
+
+    return test_failures ? 1 : 0;
+}
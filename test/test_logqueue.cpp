@@ -0,0 +1,109 @@
+// Host tests of RxV1600LogQueue, including concurrent producers
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600logqueue.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static void test_push_pop() {
+    RxV1600LogQueue::cell_t cells[4];
+    RxV1600LogQueue q(cells, 4, VirtualClock::millis);
+    unsigned cls;
+    char text[RxV1600LogQueue::TEXT_MAX];
+
+    CHECK(!q.pop(cls, text, sizeof(text)));
+
+    for( unsigned i = 0; i < 4; i++ ) {
+        CHECK(q.push(i, ("line " + std::to_string(i)).c_str()));
+    }
+    CHECK(!q.push(2, "full"));
+    CHECK(q.dropped(2) == 1 && q.dropped() == 1);
+
+    for( unsigned i = 0; i < 4; i++ ) {
+        CHECK(q.pop(cls, text, sizeof(text)));
+        CHECK(cls == i && text == "line " + std::to_string(i));
+    }
+    CHECK(!q.pop(cls, text, sizeof(text)));
+
+    // next rounds reuse the cells
+    for( unsigned i = 0; i < 10; i++ ) {
+        CHECK(q.push(RxV1600LogQueue::CLASSES + 5, std::string(200, 'x').c_str()));
+        CHECK(q.pop(cls, text, 8));
+        CHECK(cls == RxV1600LogQueue::CLASSES - 1 && std::string(text) == "xxxxxxx");
+    }
+}
+
+
+static void test_rate_limit() {
+    RxV1600LogQueue::cell_t cells[16];
+    RxV1600LogQueue q(cells, 16, VirtualClock::millis);
+    unsigned cls;
+    char text[RxV1600LogQueue::TEXT_MAX];
+
+    VirtualClock::ms = 5000;
+    q.limit(6, 3, 1000);
+
+    for( unsigned i = 0; i < 5; i++ ) q.push(6, "info");
+    CHECK(q.push(3, "error"));  // other classes are not limited
+    CHECK(q.dropped(6) == 2 && q.dropped(3) == 0);
+
+    VirtualClock::ms += 999;
+    CHECK(!q.push(6, "info"));
+    VirtualClock::ms += 1;
+    CHECK(q.push(6, "info"));
+    CHECK(q.dropped(6) == 3);
+
+    unsigned n = 0;
+    while( q.pop(cls, text, sizeof(text)) ) n++;
+    CHECK(n == 5);
+}
+
+
+static void test_concurrent() {
+    static const unsigned PRODUCERS = 4;
+    static const unsigned LINES = 2000;
+    static RxV1600LogQueue::cell_t cells[64];
+    RxV1600LogQueue q(cells, 64, VirtualClock::millis);
+
+    std::vector<std::thread> producers;
+    for( unsigned p = 0; p < PRODUCERS; p++ ) {
+        producers.emplace_back([&q, p]() {
+            for( unsigned i = 0; i < LINES; i++ ) {
+                while( !q.push(p, std::to_string(i).c_str()) ) std::this_thread::yield();
+            }
+        });
+    }
+
+    // each producer's lines arrive complete and in order
+    unsigned next[PRODUCERS] = {};
+    unsigned cls, total = 0;
+    bool ordered = true;
+    char text[RxV1600LogQueue::TEXT_MAX];
+    while( total < PRODUCERS * LINES ) {
+        if( q.pop(cls, text, sizeof(text)) ) {
+            if( cls >= PRODUCERS || std::to_string(next[cls]++) != text ) ordered = false;
+            total++;
+        }
+        else {
+            std::this_thread::yield();  // let producers run on a single CPU
+        }
+    }
+    for( std::thread &t : producers ) t.join();
+
+    CHECK(ordered);
+    CHECK(!q.pop(cls, text, sizeof(text)));
+}
+
+
+int main() {
+    RUN(test_push_pop);
+    RUN(test_rate_limit);
+    RUN(test_concurrent);
+
+    return test_failures ? 1 : 0;
+}
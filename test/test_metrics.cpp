@@ -0,0 +1,75 @@
+// Host tests of the Prometheus text rendering of RxV1600Metrics
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600metrics.h>
+
+#include <string>
+
+
+static std::string read_all( RxV1600Metrics &metrics, size_t chunk ) {
+    std::string text;
+    uint8_t buf[512];
+    size_t len;
+    while( (len = metrics.read(buf, chunk)) > 0 ) text.append((const char *)buf, len);
+    return text;
+}
+
+
+static size_t extra( unsigned line, char *buf, size_t size, void *ctx ) {
+    return RxV1600Metrics::value_line(line, buf, size, "test_extra", "gauge", *(uint32_t *)ctx);
+}
+
+
+static void test_text() {
+    MockStream stream;
+    RxV1600Comm comm(stream, VirtualClock::millis);
+    VirtualClock::ms = 1000;
+
+    comm.send(STX "07A1A" ETX);
+    comm.handle();
+    VirtualClock::ms += 30;
+    stream.receive(STX "0026C7" ETX);
+    comm.handle();
+
+    uint32_t value = 42;
+    RxV1600Metrics whole(comm, "receiver=\"rx1\"", extra, &value);
+    RxV1600Metrics chunked(comm, "receiver=\"rx1\"", extra, &value);
+    std::string text = read_all(whole, 512);
+    CHECK(read_all(chunked, 7) == text);
+
+    CHECK(text.find("# TYPE rxv1600_sent_total counter\nrxv1600_sent_total{receiver=\"rx1\"} 1\n") != std::string::npos);
+    CHECK(text.find("rxv1600_frames_total{receiver=\"rx1\"} 1\n") != std::string::npos);
+    CHECK(text.find("rxv1600_latency_ms_bucket{le=\"15\",receiver=\"rx1\"} 0\n") != std::string::npos);
+    CHECK(text.find("rxv1600_latency_ms_bucket{le=\"31\",receiver=\"rx1\"} 1\n") != std::string::npos);
+    CHECK(text.find("rxv1600_latency_ms_bucket{le=\"+Inf\",receiver=\"rx1\"} 1\n") != std::string::npos);
+    CHECK(text.find("rxv1600_latency_ms_sum{receiver=\"rx1\"} 30\n") != std::string::npos);
+    CHECK(text.find("rxv1600_gap_ms_count{receiver=\"rx1\"} 0\n") != std::string::npos);
+    CHECK(text.find("# TYPE test_extra gauge\ntest_extra 42\n") == text.size() - 38);
+}
+
+
+static void test_histogram_line() {
+    uint32_t buckets[RxV1600Comm::HIST_BUCKETS] = { 1, 2, 3 };
+    char buf[RxV1600Metrics::LINE_MAX];
+
+    CHECK(RxV1600Metrics::histogram_line(0, buf, sizeof(buf), "h", buckets, 9) > 0 && std::string(buf) == "# TYPE h histogram\n");
+    RxV1600Metrics::histogram_line(1, buf, sizeof(buf), "h", buckets, 9);
+    CHECK(std::string(buf) == "h_bucket{le=\"0\"} 1\n");
+    RxV1600Metrics::histogram_line(3, buf, sizeof(buf), "h", buckets, 9);
+    CHECK(std::string(buf) == "h_bucket{le=\"3\"} 6\n");
+    RxV1600Metrics::histogram_line(RxV1600Comm::HIST_BUCKETS + 2, buf, sizeof(buf), "h", buckets, 9);
+    CHECK(std::string(buf) == "h_count 6\n");
+    CHECK(RxV1600Metrics::histogram_line(RxV1600Metrics::HISTOGRAM_LINES, buf, sizeof(buf), "h", buckets, 9) == 0);
+
+    CHECK(RxV1600Metrics::value_line(1, buf, 8, "long_metric_name", "gauge", 1) == 7);  // truncated
+}
+
+
+int main() {
+    RUN(test_text);
+    RUN(test_histogram_line);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+// Host tests of RxV1600Profiler and the RXV_PROFILE() macro
+
+#define RXV1600_PROFILE
+#include <rxv1600profiler.h>
+
+#include "test.h"
+
+#include <string.h>
+
+
+static uint32_t clock_us = 0;
+static uint32_t virtual_micros() { return clock_us; }
+
+static const char *const names[] = { "comm", "mqtt" };
+enum { P_COMM, P_MQTT };
+
+
+static void handler( uint32_t us ) {
+    clock_us += us;
+}
+
+
+static void test_measure() {
+    RxV1600Profiler prof(names, 2, virtual_micros);
+
+    CHECK(prof.slots() == 2);
+    CHECK(strcmp(prof.name(P_MQTT), "mqtt") == 0 && prof.name(2) == NULL && prof.get(2) == NULL);
+    CHECK(prof.percentile(P_COMM, 50) == 0 && prof.rate(P_COMM) == 0);
+
+    // 98 fast calls, one of 100 µs and one of 5000 µs, every 10 ms
+    for( unsigned i = 0; i < 100; i++ ) {
+        RXV_PROFILE(prof, P_COMM, handler(i == 10 ? 100 : i == 20 ? 5000 : 10));
+        RXV_PROFILE(prof, P_MQTT, handler(0));
+        clock_us += 10000 - (i == 10 ? 100 : i == 20 ? 5000 : 10);
+    }
+
+    const RxV1600Profiler::slot_t *s = prof.get(P_COMM);
+    CHECK(s->calls == 100 && s->max_us == 5000);
+    CHECK(s->hist[RxV1600Comm::bucket(10)] == 98);
+    CHECK(prof.percentile(P_COMM, 50) == 15);    // bucket [8, 16)
+    CHECK(prof.percentile(P_COMM, 99) == 127);   // bucket [64, 128)
+    CHECK(prof.percentile(P_COMM, 100) == 5000); // limited by max
+    CHECK(prof.percentile(P_MQTT, 99) == 0);
+
+    prof.end(7, prof.begin());  // invalid slot is ignored, but updates the elapsed time
+    CHECK(prof.get(P_COMM)->calls == 100);
+    CHECK(prof.rate(P_COMM) == 100 && prof.rate(P_MQTT) == 100);
+
+    prof.reset();
+    CHECK(prof.get(P_COMM)->calls == 0 && prof.get(P_COMM)->max_us == 0 && prof.rate(P_COMM) == 0);
+}
+
+
+static void test_wrap() {
+    RxV1600Profiler prof(names, 2, virtual_micros);
+
+    clock_us = 0xFFFFFF00;
+    prof.reset();
+    uint32_t start = prof.begin();
+    clock_us += 0x200;  // micros() wraps during the call
+    prof.end(P_COMM, start);
+    CHECK(prof.get(P_COMM)->max_us == 0x200);
+    CHECK(prof.rate(P_COMM) == 1000000 / 0x200);
+}
+
+
+static void test_json() {
+    RxV1600Profiler prof(names, 2, virtual_micros);
+    char buf[128];
+
+    clock_us = 0;
+    prof.reset();
+    clock_us = 1000000;
+    prof.end(P_MQTT, clock_us - 300);
+
+    size_t len = prof.json(P_MQTT, buf, sizeof(buf));
+    CHECK(len == strlen(buf));
+    CHECK(strcmp(buf, "{\"name\":\"mqtt\",\"calls\":1,\"rate\":1,\"p50_us\":300,\"p99_us\":300,\"max_us\":300}") == 0);
+
+    CHECK(prof.json(P_MQTT, buf, 10) == 9 && strlen(buf) == 9);
+    CHECK(prof.json(2, buf, sizeof(buf)) == 0);
+}
+
+
+int main() {
+    RUN(test_measure);
+    RUN(test_wrap);
+    RUN(test_json);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+// Host tests of RxV1600 encoding and decoding
+
+#include "test.h"
+
+#include <rxv1600.h>
+
+#include <string>
+
+
+// config response with power on and main volume 0 dB, all other values 0
+static std::string config( const char *volume = "C7" ) {
+    std::string resp = DC2 "R0161" "98" "0000000";
+    resp += std::string(150, '0');
+    resp[17] = '1';  // Power: all zones on
+    resp[24] = volume[0];
+    resp[25] = volume[1];
+    return resp + ETX;
+}
+
+
+static bool is_set( const uint8_t *bits, uint8_t id ) {
+    return bits[id >> 3] & (1 << (id & 7));
+}
+
+
+static void test_command() {
+    CHECK(std::string(RxV1600::command("Ready")) == DC1 "000" ETX);
+    CHECK(std::string(RxV1600::command("MainVolume_Up")) == STX "07A1A" ETX);
+    CHECK(RxV1600::command("NoSuchCommand") == NULL);
+    CHECK(std::string(RxV1600::command_value("MainVolumeSet", 0xC7)) == STX "230C7" ETX);
+}
+
+
+static void test_decode_report() {
+    RxV1600 rxv;
+    uint8_t id;
+    RxV1600::guard_t guard;
+    RxV1600::origin_t origin;
+
+    CHECK(rxv.report_value(0x26) == (uint8_t)RxV1600::UNKNOWN_VALUE);
+    CHECK(rxv.decode(STX "1026B0" ETX, id, guard, origin));
+    CHECK(id == 0x26 && guard == RxV1600::G_NONE && origin == RxV1600::O_IR);
+    CHECK(rxv.report_value(0x26) == 0xB0);
+    CHECK(std::string(rxv.report_value_string(0x26)) == "-11.5 dB");
+
+    CHECK(!rxv.decode(STX "1026B" ETX, id, guard, origin));  // too short
+    CHECK(!rxv.decode(STX "102GB0" ETX, id, guard, origin));  // no hex
+}
+
+
+static void test_config_changes() {
+    RxV1600 rxv;
+    bool power;
+    uint8_t changed[32];
+
+    CHECK(rxv.decodeConfig(config().c_str(), power, changed));
+    CHECK(power);
+    CHECK(rxv.report_value(0x26) == 0xC7);
+    CHECK(is_set(changed, 0x26) && is_set(changed, 0x20));
+    CHECK(rxv.divergences() == 0);  // unknown values are no divergence
+
+    CHECK(rxv.decodeConfig(config().c_str(), power, changed));
+    for( unsigned id = 0; id <= 0xFF; id++ ) {
+        CHECK(!is_set(changed, id));
+    }
+
+    // missed volume report: next config corrects exactly that
+    CHECK(rxv.decodeConfig(config("B0").c_str(), power, changed));
+    CHECK(rxv.report_value(0x26) == 0xB0);
+    CHECK(is_set(changed, 0x26) && !is_set(changed, 0x20));
+    CHECK(rxv.divergences() == 1);
+}
+
+
+static void test_state_json() {
+    RxV1600 rxv;
+    uint8_t id;
+    RxV1600::guard_t guard;
+    RxV1600::origin_t origin;
+    char buf[2048];
+
+    CHECK(rxv.state_json(buf, sizeof(buf)) == 2 && std::string(buf) == "{}");
+
+    CHECK(rxv.decode(STX "0026B2" ETX, id, guard, origin));  // MainVolume -10.5 dB
+    CHECK(rxv.decode(STX "002818" ETX, id, guard, origin));  // Program Pop/Rock
+    std::string json = "{\"MainVolume\":-10.5,\"Program\":\"Pop/Rock\"}";
+    CHECK(rxv.state_json(buf, sizeof(buf)) == json.size() && buf == json);
+
+    // truncated like snprintf
+    CHECK(rxv.state_json(buf, 10) == json.size() && std::string(buf) == json.substr(0, 9));
+
+    // volumes below the settable range are no dB numbers
+    CHECK(rxv.decode(STX "002600" ETX, id, guard, origin));
+    CHECK(rxv.state_json(buf, sizeof(buf)) > 0 && std::string(buf).find("\"MainVolume\":\"Infinite\"") != std::string::npos);
+    CHECK(rxv.decode(STX "002610" ETX, id, guard, origin));
+    CHECK(rxv.state_json(buf, sizeof(buf)) > 0 && std::string(buf).find("\"MainVolume\":null") != std::string::npos);
+    CHECK(rxv.decode(STX "0026B2" ETX, id, guard, origin));
+
+    bool power;
+    CHECK(rxv.decodeConfig(config().c_str(), power));
+    size_t len = rxv.state_json(buf, sizeof(buf));
+    CHECK(len < sizeof(buf) && len == strlen(buf) && buf[0] == '{' && buf[len - 1] == '}');
+    CHECK(std::string(buf).find("\"MainVolume\":0.0") != std::string::npos);
+}
+
+
+static void test_catalog() {
+    std::string catalog = RxV1600::catalog();
+
+    CHECK(catalog.size() == RxV1600::catalog_length());
+    CHECK(catalog.compare(0, 14, "{\"commands\":[\"") == 0 && catalog.back() == '}');
+    for( auto it = RxV1600::begin(); it != RxV1600::end(); it++ ) {
+        CHECK(catalog.find("\"" + std::string(it->first) + "\"") != std::string::npos);
+    }
+    CHECK(catalog.find("{\"name\":\"MainVolumeSet\",\"min\":39,\"max\":232}") != std::string::npos);
+    CHECK(catalog.find("\"0x26\":\"MainVolume\"") != std::string::npos);
+    CHECK(catalog.find(",,") == std::string::npos && catalog.find(",]") == std::string::npos && catalog.find(",}") == std::string::npos);
+}
+
+
+int main() {
+    RUN(test_command);
+    RUN(test_decode_report);
+    RUN(test_config_changes);
+    RUN(test_state_json);
+    RUN(test_catalog);
+
+    return test_failures ? 1 : 0;
+}
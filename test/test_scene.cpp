@@ -0,0 +1,141 @@
+// Host tests of RxV1600Scene with reports fed by the tests
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600scene.h>
+
+#include <string>
+
+
+static const std::string SYS_BUSY = STX "000001" ETX;  // System Busy
+static const std::string SYS_OK = STX "000000" ETX;    // System Ok
+static const std::string POWER_ON = STX "002001" ETX;  // Power: all zones on
+static const std::string POWER_OFF = STX "002000" ETX; // Power: all zones off
+static const std::string ZONE2_ON = STX "002006" ETX;  // Power: only zone 2 on
+
+static const RxV1600Scene::step_t SCENE_BT[] = {
+    RXV_CMD("MainZonePower_On"), RXV_READY(0, 8000), RXV_CMD("Input_Dtv"), RXV_END };
+static const RxV1600Scene::scene_t SCENES[] = {
+    { "bt", SCENE_BT }
+};
+
+
+struct Fixture {
+    Fixture() : comm(stream, VirtualClock::millis), scenes(comm, rxv, SCENES, 1) {
+        VirtualClock::ms = 1000;
+        comm.on_recv(recvd, this);
+        scenes.on_done(done, this);
+    }
+
+    static void recvd( const char *resp, void *ctx ) {
+        Fixture &f = *(Fixture *)ctx;
+        uint8_t id;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+        if( resp ) f.rxv.decode(resp, id, guard, origin);
+    }
+
+    static void done( const char *, bool, void *ctx ) {
+        ((Fixture *)ctx)->dones++;
+    }
+
+    // receiver sends a report
+    void receive( const std::string &report, uint32_t ms = 100 ) {
+        stream.receive(report);
+        advance(ms);
+    }
+
+    void advance( uint32_t ms ) {
+        while( ms-- ) {
+            VirtualClock::ms++;
+            comm.handle();
+            scenes.handle();
+        }
+    }
+
+    bool sent( const char *name ) const {
+        return stream.out.find(RxV1600::command(name)) != std::string::npos;
+    }
+
+    MockStream stream;
+    RxV1600Comm comm;
+    RxV1600 rxv;
+    RxV1600Scene scenes;
+    unsigned dones = 0;
+};
+
+
+static void test_ready_after_busy() {
+    Fixture f;
+
+    f.receive(SYS_OK);
+    f.receive(POWER_OFF);
+    CHECK(f.scenes.start("bt"));
+    f.advance(100);
+    CHECK(f.sent("MainZonePower_On"));
+
+    // Power report before Busy: the cached Ok is from before power on
+    f.receive(POWER_ON);
+    CHECK(f.rxv.ready(0));
+    CHECK(!f.sent("Input_Dtv"));
+    f.receive(SYS_BUSY, 2000);
+    CHECK(!f.sent("Input_Dtv"));
+
+    f.receive(SYS_OK);
+    CHECK(f.sent("Input_Dtv"));
+    f.receive(STX "002107" ETX);
+    CHECK(f.dones == 1 && !f.scenes.running());
+}
+
+
+static void test_ready_when_on() {
+    Fixture f;
+
+    // zone already on: no power on, so no Busy to wait for
+    f.receive(SYS_OK);
+    f.receive(POWER_ON);
+    CHECK(f.scenes.start("bt"));
+    f.advance(100);
+    f.receive(POWER_ON);
+    CHECK(f.sent("Input_Dtv"));
+}
+
+
+static void test_ready_other_zone_on() {
+    Fixture f;
+
+    // zone 2 on: powering on the main zone reports no Busy, the Power report is enough
+    f.receive(SYS_OK);
+    f.receive(ZONE2_ON);
+    CHECK(f.scenes.start("bt"));
+    f.advance(100);
+    CHECK(f.sent("MainZonePower_On") && !f.sent("Input_Dtv"));
+    f.receive(POWER_ON);
+    CHECK(f.sent("Input_Dtv"));
+}
+
+
+static void test_ready_timeout() {
+    Fixture f;
+
+    // Busy report got lost: continue after the timeout
+    f.receive(SYS_OK);
+    f.receive(POWER_OFF);
+    CHECK(f.scenes.start("bt"));
+    f.advance(100);
+    f.receive(POWER_ON, 7000);
+    CHECK(!f.sent("Input_Dtv"));
+    f.advance(1200);
+    CHECK(f.sent("Input_Dtv"));
+}
+
+
+int main() {
+    RUN(test_ready_after_busy);
+    RUN(test_ready_when_on);
+    RUN(test_ready_other_zone_on);
+    RUN(test_ready_timeout);
+
+    return test_failures ? 1 : 0;
+}
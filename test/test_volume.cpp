@@ -0,0 +1,300 @@
+// Host tests of RxV1600Volume coalescing, driven by a virtual clock
+
+#include "mock_stream.h"
+#include "test.h"
+
+#include <rxv1600volume.h>
+
+#include <string>
+#include <vector>
+
+
+static const std::string MAIN_80 = STX "002680" ETX;   // MainVolume report 0x80
+static const std::string ZONE2_60 = STX "002760" ETX;  // Zone2Volume report 0x60
+static const std::string SYS_OK = STX "000000" ETX;    // System Ok, answers any command here
+
+
+struct Fixture {
+    Fixture() : comm(stream, VirtualClock::millis), volume(comm, rxv) {
+        VirtualClock::ms = 1000;
+        comm.on_recv(recvd, this);
+    }
+
+    static void recvd( const char *resp, void *ctx ) {
+        Fixture &f = *(Fixture *)ctx;
+        uint8_t id;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+        if( resp ) f.rxv.decode(resp, id, guard, origin);
+    }
+
+    // receiver sends a report, e.g. as response to a command
+    void receive( const std::string &report, uint32_t ms = 100 ) {
+        stream.receive(report);
+        advance(ms);
+    }
+
+    // advance virtual time in 1 ms steps and handle on each
+    void advance( uint32_t ms ) {
+        while( ms-- ) {
+            VirtualClock::ms++;
+            comm.handle();
+            if( answer && commands() > answered ) {
+                answered = commands();
+                stream.receive(SYS_OK);
+            }
+            volume.handle();
+        }
+    }
+
+    // number of times a volume set command with value was written
+    size_t sent( const char *name, uint8_t value ) const {
+        std::string cmd = RxV1600::command_value(name, value);
+        size_t n = 0;
+        for( size_t pos = stream.out.find(cmd); pos != std::string::npos; pos = stream.out.find(cmd, pos + 1) ) n++;
+        return n;
+    }
+
+    // number of times a command was written
+    size_t sent( const char *name ) const {
+        std::string cmd = RxV1600::command(name);
+        size_t n = 0;
+        for( size_t pos = stream.out.find(cmd); pos != std::string::npos; pos = stream.out.find(cmd, pos + 1) ) n++;
+        return n;
+    }
+
+    // values of all volume set commands written, in order
+    std::vector<uint8_t> values( const char *name ) const {
+        std::string prefix = RxV1600::command_value(name, 0);
+        prefix.resize(prefix.size() - 3);  // without value and ETX
+        std::vector<uint8_t> result;
+        for( size_t pos = stream.out.find(prefix); pos != std::string::npos; pos = stream.out.find(prefix, pos + 1) ) {
+            result.push_back(strtoul(stream.out.substr(pos + prefix.size(), 2).c_str(), NULL, 16));
+        }
+        return result;
+    }
+
+    // number of commands written
+    size_t commands() const {
+        size_t n = 0;
+        for( char ch : stream.out ) n += ch == *ETX;
+        return n;
+    }
+
+    MockStream stream;
+    RxV1600Comm comm;
+    RxV1600 rxv;
+    RxV1600Volume volume;
+    bool answer = false;  // receiver answers every command
+    size_t answered = 0;
+};
+
+
+static void test_coalesce() {
+    Fixture f;
+
+    f.receive(MAIN_80);
+
+    // a burst of steps becomes one absolute target
+    CHECK(f.volume.command("MainVolume_Up"));
+    CHECK(f.volume.command("MainVolume_Up"));
+    CHECK(f.volume.step(RxV1600Volume::Z_MAIN, 3));
+    CHECK(f.volume.pending(RxV1600Volume::Z_MAIN));
+    f.advance(2);  // handle() hands the target to comm, the next comm handle() writes it
+    CHECK(f.commands() == 1 && f.sent("MainVolumeSet", 0x85) == 1);
+    CHECK(!f.volume.pending(RxV1600Volume::Z_MAIN));
+
+    // slider positions while the command is active: only the newest is sent
+    CHECK(f.volume.command_value("MainVolumeSet", 0x90));
+    CHECK(f.volume.command_value("MainVolumeSet", 0x98));
+    f.advance(50);
+    CHECK(f.commands() == 1);
+    f.receive(STX "002685" ETX);
+    CHECK(f.commands() == 2 && f.sent("MainVolumeSet", 0x98) == 1 && f.sent("MainVolumeSet", 0x90) == 0);
+
+    // limits
+    f.volume.set(RxV1600Volume::Z_MAIN, 0xFF);
+    f.receive(STX "002698" ETX);
+    CHECK(f.sent("MainVolumeSet", RxV1600Volume::MAX_VALUE) == 1);
+    CHECK(!f.volume.command("Input_Dtv") && !f.volume.command_value("Input_Dtv", 1));
+}
+
+
+static void test_settle_base() {
+    Fixture f;
+
+    f.receive(MAIN_80);
+    CHECK(f.volume.step(RxV1600Volume::Z_MAIN, 1));
+    f.advance(2);
+    CHECK(f.sent("MainVolumeSet", 0x81) == 1);
+
+    // the report of the new volume is late: steps build on the sent target
+    f.receive(MAIN_80);
+    CHECK(f.volume.step(RxV1600Volume::Z_MAIN, 1));
+    f.advance(2);
+    CHECK(f.sent("MainVolumeSet", 0x82) == 1);
+    f.receive(MAIN_80);
+
+    // after SETTLE_MS the reported volume is the base again
+    f.advance(RxV1600Volume::SETTLE_MS);
+    CHECK(f.volume.step(RxV1600Volume::Z_MAIN, 1));
+    f.advance(2);
+    CHECK(f.sent("MainVolumeSet", 0x81) == 2);
+}
+
+
+static void test_unknown_volume() {
+    Fixture f;
+
+    // no report yet: callers send the relative command instead
+    CHECK(!f.volume.command("MainVolume_Up"));
+    CHECK(!f.volume.command("MainVolume_Down"));
+    CHECK(!f.volume.step(RxV1600Volume::Z_MAIN, 1));
+    CHECK(!f.volume.pending(RxV1600Volume::Z_MAIN));
+    f.advance(10);
+    CHECK(f.stream.out.empty());
+
+    // absolute targets need no base
+    CHECK(f.volume.command_value("MainVolumeSet", 0x80));
+    f.advance(2);
+    CHECK(f.sent("MainVolumeSet", 0x80) == 1);
+
+    // while settling the sent target is the base
+    f.receive(MAIN_80);
+    CHECK(f.volume.command("MainVolume_Up"));
+}
+
+
+static void test_zones() {
+    Fixture f;
+
+    f.receive(MAIN_80);
+    f.receive(ZONE2_60);
+
+    CHECK(f.volume.step(RxV1600Volume::Z_MAIN, 2));
+    CHECK(f.volume.command("Zone2Volume_Down"));
+    CHECK(!f.volume.command("Zone3Volume_Up"));  // zone 3 not yet reported
+    CHECK(f.volume.pending(RxV1600Volume::Z_MAIN) && f.volume.pending(RxV1600Volume::Z_ZONE2));
+    CHECK(!f.volume.pending(RxV1600Volume::Z_ZONE3));
+
+    // one command at a time, each zone with its own target
+    f.advance(2);
+    CHECK(f.commands() == 1 && f.sent("MainVolumeSet", 0x82) == 1);
+    f.receive(STX "002682" ETX);
+    CHECK(f.commands() == 2 && f.sent("Zone2VolumeSet", 0x5F) == 1);
+    f.receive(STX "00275F" ETX);
+
+    // a step of one zone does not stack on the target of another
+    CHECK(f.volume.command("Zone2Volume_Up"));
+    f.advance(2);
+    CHECK(f.sent("Zone2VolumeSet", 0x60) == 1 && f.sent("MainVolumeSet", 0x83) == 0);
+}
+
+
+static void test_ramp() {
+    Fixture f;
+
+    f.receive(MAIN_80);
+    f.answer = true;
+    CHECK(f.volume.ramp(RxV1600Volume::Z_MAIN, 0xA0, 1000, RxV1600Volume::C_LINEAR, "MainZonePower_Off"));
+    CHECK(f.volume.ramping(RxV1600Volume::Z_MAIN));
+    f.advance(1500);
+    CHECK(!f.volume.ramping(RxV1600Volume::Z_MAIN));
+
+    // steps at the ramp interval, ending exactly at the target
+    std::vector<uint8_t> v = f.values("MainVolumeSet");
+    CHECK(v.size() == 1000 / RxV1600Volume::RAMP_INTERVAL_MS);
+    for( size_t i = 1; i < v.size(); i++ ) CHECK(v[i] > v[i - 1]);
+    CHECK(v.back() == 0xA0);
+
+    // follow up command once, after the last step
+    CHECK(f.sent("MainZonePower_Off") == 1);
+    CHECK(f.stream.out.rfind(RxV1600::command("MainZonePower_Off")) > f.stream.out.rfind(RxV1600::command_value("MainVolumeSet", 0xA0)));
+    f.advance(1000);
+    CHECK(f.sent("MainZonePower_Off") == 1);
+
+    // unknown follow up command or curve
+    CHECK(!f.volume.ramp(RxV1600Volume::Z_MAIN, 0x80, 1000, RxV1600Volume::C_LINEAR, "NoSuchCommand"));
+    CHECK(!f.volume.ramp(RxV1600Volume::Z_MAIN, 0x80, 1000, RxV1600Volume::C_UNKNOWN));
+}
+
+
+static void test_ramp_curves() {
+    const struct {
+        RxV1600Volume::curve_t curve;
+        uint8_t mid;  // value half way
+    } cases[] = {
+        { RxV1600Volume::C_LINEAR,   0x90 },
+        { RxV1600Volume::C_EASE_IN,  0x88 },
+        { RxV1600Volume::C_EASE_OUT, 0x98 },
+        { RxV1600Volume::C_SMOOTH,   0x90 },
+    };
+
+    for( auto &c : cases ) {
+        Fixture f;
+        f.receive(MAIN_80);
+        f.answer = true;
+        CHECK(f.volume.ramp(RxV1600Volume::Z_MAIN, 0xA0, 1000, c.curve));
+        f.advance(1500);
+        std::vector<uint8_t> v = f.values("MainVolumeSet");
+        CHECK(v.size() == 4 && v[1] == c.mid && v.back() == 0xA0);
+    }
+
+    // fade out steps down towards the lowest volume, then ends at Infinite
+    Fixture f;
+    f.receive(MAIN_80);
+    f.answer = true;
+    CHECK(f.volume.ramp(RxV1600Volume::Z_MAIN, 0, 1000, RxV1600Volume::C_LINEAR));
+    f.advance(1500);
+    std::vector<uint8_t> v = f.values("MainVolumeSet");
+    CHECK(v.size() == 4 && v[2] > RxV1600Volume::MIN_VALUE && v.back() == 0);
+    CHECK(RxV1600Volume::ramp_curve("Smooth") == RxV1600Volume::C_SMOOTH && RxV1600Volume::ramp_curve("x") == RxV1600Volume::C_UNKNOWN);
+}
+
+
+static void test_ramp_then_per_zone() {
+    Fixture f;
+
+    f.receive(MAIN_80);
+    f.receive(ZONE2_60);
+    f.answer = true;
+
+    // ramps of two zones finishing together both send their follow up command
+    CHECK(f.volume.ramp(RxV1600Volume::Z_MAIN, 0x40, 1000, RxV1600Volume::C_LINEAR, "MainZonePower_Off"));
+    CHECK(f.volume.ramp(RxV1600Volume::Z_ZONE2, 0x40, 1000, RxV1600Volume::C_LINEAR, "Zone2Mute_On"));
+    f.advance(2000);
+    CHECK(f.values("MainVolumeSet").back() == 0x40 && f.values("Zone2VolumeSet").back() == 0x40);
+    CHECK(f.sent("MainZonePower_Off") == 1 && f.sent("Zone2Mute_On") == 1);
+}
+
+
+static void test_ramp_cancel() {
+    Fixture f;
+
+    f.receive(MAIN_80);
+    f.answer = true;
+    CHECK(f.volume.ramp(RxV1600Volume::Z_MAIN, 0x40, 1000, RxV1600Volume::C_LINEAR, "MainZonePower_Off"));
+    f.advance(600);
+    size_t steps = f.values("MainVolumeSet").size();
+    f.volume.cancel();
+    CHECK(!f.volume.ramping(RxV1600Volume::Z_MAIN));
+    f.advance(2000);
+
+    // volume stays at the last step and the follow up command is dropped
+    CHECK(f.values("MainVolumeSet").size() == steps);
+    CHECK(f.sent("MainZonePower_Off") == 0);
+}
+
+
+int main() {
+    RUN(test_coalesce);
+    RUN(test_settle_base);
+    RUN(test_unknown_volume);
+    RUN(test_zones);
+    RUN(test_ramp);
+    RUN(test_ramp_curves);
+    RUN(test_ramp_then_per_zone);
+    RUN(test_ramp_cancel);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,335 @@
+// Linux gateway daemon for Yamaha RX-V1600 AV Receivers on serial ports
+// One thread serves all ports with an epoll event loop.
+// Commands are read from stdin as "<topic>/<name>/cmd <payload>" lines, status changes are
+// written to stdout as "<topic>/<name>/status/<Report> <value>" lines. Payloads are the same
+// as for Mqtt_RxV1600: Name[,value], a batch of them separated by ';' or as JSON array, help or
+// reset. So a broker can be connected like this:
+//   mosquitto_sub -v -t 'rxv1600/+/cmd' | rxv1600d a=/dev/ttyUSB0 b=/dev/ttyUSB1 |
+//     while read -r t p; do mosquitto_pub -t "$t" -m "$p"; done
+// With -d the library logs the serial traffic to stderr.
+// Usage: rxv1600d [-d] [-t topic] [-r reconcile_s] [name=]device...
+
+#include <rxv1600.h>
+#include <rxv1600batch.h>
+#include <rxv1600log.h>
+#include <rxv1600volume.h>
+#include <serialstream.h>
+
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+
+static const uint32_t REOPEN_MS = 5000;  // retry interval for failed serial ports
+static const long TICK_NS = 5000000;     // handle timeouts every 5 ms
+
+
+// Everything one receiver needs
+class Receiver {
+    public:
+
+    Receiver( const std::string &name, const std::string &device ) :
+        name(name), device(device), comm(serial), volume(comm, rxv), batch(comm), failed_ms(0) {
+    }
+
+    std::string name;    // topic level of this receiver
+    std::string device;  // serial port
+    SerialStream serial;
+    RxV1600Comm comm;
+    RxV1600 rxv;
+    RxV1600Volume volume;
+    RxV1600Batch batch;  // commands of payloads, queued per line
+    uint32_t failed_ms;  // time the port failed or 0
+};
+
+
+static const char *topic = "rxv1600";
+static int epfd = -1;
+
+
+static void publish( const Receiver &r, const char *name, const char *value ) {
+    printf("%s/%s/status/%s %s\n", topic, r.name.c_str(), name, value ? value : "");
+    fflush(stdout);
+}
+
+
+static void recvd( const char *resp, void *ctx ) {
+    Receiver &r = *(Receiver *)ctx;
+    bool power;
+    uint8_t id;
+    RxV1600::guard_t guard;
+    RxV1600::origin_t origin;
+    char text[9];
+    uint8_t changed[32];
+    const char *name;
+
+    if( !resp ) {
+        fprintf(stderr, "%s: TIMEOUT\n", r.name.c_str());
+    }
+    else if( r.rxv.decodeConfig(resp, power, changed) ) {
+        for( unsigned i = 0; i <= 0xFF; i++ ) {
+            name = r.rxv.report_name(i);
+            if( name && (changed[i >> 3] & (1 << (i & 7))) ) {
+                publish(r, name, r.rxv.report_value_string(i));
+            }
+        }
+    }
+    else if( r.rxv.decode(resp, id, guard, origin) ) {
+        name = r.rxv.report_name(id);
+        if( name ) publish(r, name, r.rxv.report_value_string(id));
+    }
+    else if( r.rxv.decodeText(resp, id, text) ) {
+        name = r.rxv.display_name(id);
+        if( name ) publish(r, name, text);
+    }
+    else {
+        fprintf(stderr, "%s: ignoring unknown response '%s'\n", r.name.c_str(), resp);
+    }
+}
+
+
+static void link_changed( RxV1600Comm::link_t link, void *ctx ) {
+    Receiver &r = *(Receiver *)ctx;
+    publish(r, "Link", RxV1600Comm::link_name(link));
+}
+
+
+static bool open_port( Receiver &r ) {
+    if( !r.serial.open(r.device.c_str()) ) {
+        fprintf(stderr, "%s: cannot open %s: %s\n", r.name.c_str(), r.device.c_str(), strerror(errno));
+        r.failed_ms = (millis() - 1) | 1;
+        return false;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &r;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, r.serial.fd(), &ev);
+    r.failed_ms = 0;
+    r.comm.send(RxV1600::command("Ready"));
+    return true;
+}
+
+
+static void close_port( Receiver &r ) {
+    if( r.serial.fd() >= 0 ) {
+        epoll_ctl(epfd, EPOLL_CTL_DEL, r.serial.fd(), NULL);
+        r.serial.close();
+    }
+    r.failed_ms = (millis() - 1) | 1;
+}
+
+
+// Handle a payload with one daemon command: volume target, help or reset
+// Returns false if the payload is for the command batch queue
+static bool daemon_command( Receiver &r, const char *payload, size_t length ) {
+    RxV1600Batch::cursor_t cur;
+    RxV1600Batch::span_t item, rest, field;
+    char name[RxV1600Batch::NAME_MAX];
+
+    RxV1600Batch::begin(cur, payload, length);
+    if( !RxV1600Batch::next(cur, item) || RxV1600Batch::next(cur, rest) || cur.error ) return false;
+
+    rest = item;
+    RxV1600Batch::split(rest, field);
+    if( !RxV1600Batch::copy(field, name, sizeof(name)) ) return false;
+
+    if( !rest.str ) {
+        if( strcasecmp("help", name) == 0 ) {
+            printf("%s/%s/commands %s\n", topic, r.name.c_str(), RxV1600::catalog());
+            fflush(stdout);
+            return true;
+        }
+        if( strcasecmp("reset", name) == 0 ) {
+            fprintf(stderr, "%s: reopen %s\n", r.name.c_str(), r.device.c_str());
+            close_port(r);
+            open_port(r);
+            return true;
+        }
+        return r.volume.command(name);  // sent later as newest volume target
+    }
+
+    char value[8];
+    char *endp;
+    if( !RxV1600Batch::split(rest, field) || rest.str || !RxV1600Batch::copy(field, value, sizeof(value)) ) return false;
+    unsigned long number = strtoul(value, &endp, 0);
+    return *value && !*endp && number <= 0xff && r.volume.command_value(name, number);  // sent later as newest volume target
+}
+
+
+// Handle one payload, same grammar as mqtt_callback() of Mqtt_RxV1600
+static void command( Receiver &r, const char *payload ) {
+    size_t length = strlen(payload);
+
+    if( daemon_command(r, payload, length) ) return;
+
+    unsigned failed;
+    RxV1600Batch::error_t error = r.batch.submit(payload, length, &failed);
+    if( error ) {
+        fprintf(stderr, "%s: discarding payload: %s at command %u\n", r.name.c_str(), RxV1600Batch::error_name(error), failed + 1);
+    }
+    else {
+        r.volume.cancel();  // user command stops fading
+    }
+}
+
+
+// Parse "<topic>/<name>/cmd <payload>" lines
+static void input_line( std::vector<Receiver *> &receivers, char *line ) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    char *payload = strchr(line, ' ');
+    if( !payload ) return;
+    *(payload++) = '\0';
+
+    size_t len = strlen(topic);
+    if( strncmp(line, topic, len) != 0 || line[len] != '/' ) return;
+    char *name = &line[len + 1];
+    char *sep = strrchr(name, '/');
+    if( !sep || strcmp(sep, "/cmd") != 0 ) return;
+    *sep = '\0';
+
+    for( Receiver *r : receivers ) {
+        if( r->name == name ) {
+            command(*r, payload);
+            return;
+        }
+    }
+    fprintf(stderr, "unknown receiver '%s'\n", name);
+}
+
+
+// Read what stdin has without blocking and handle each complete line
+// Returns false at the end of input
+static bool read_input( std::vector<Receiver *> &receivers ) {
+    static char line[256];
+    static size_t len = 0;
+    static bool skip = false;  // discard the rest of a too long line
+
+    while( true ) {
+        ssize_t n = ::read(STDIN_FILENO, &line[len], sizeof(line) - 1 - len);
+        if( n < 0 ) return errno == EAGAIN || errno == EINTR;
+        if( n == 0 ) {
+            // a last line may lack its newline
+            line[len] = '\0';
+            if( len && !skip ) input_line(receivers, line);
+            len = 0;
+            return false;
+        }
+        len += n;
+
+        char *start = line;
+        char *end;
+        while( (end = (char *)memchr(start, '\n', &line[len] - start)) != NULL ) {
+            *end = '\0';
+            if( !skip ) input_line(receivers, start);
+            skip = false;
+            start = end + 1;
+        }
+        len = &line[len] - start;
+        memmove(line, start, len);
+
+        if( len == sizeof(line) - 1 ) {
+            fprintf(stderr, "discarding too long input line\n");
+            skip = true;
+            len = 0;
+        }
+    }
+}
+
+
+static void log_line( RxV1600Log::level_t level, const char *line, void * ) {
+    fprintf(stderr, "%s %s\n", RxV1600Log::level_name(level), line);
+}
+
+
+int main( int argc, char *argv[] ) {
+    uint32_t reconcile_ms = 5 * 60 * 1000;
+    std::vector<Receiver *> receivers;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "dt:r:")) != -1 ) {
+        switch( opt ) {
+            case 'd': RxV1600Log::sink(log_line); break;
+            case 't': topic = optarg; break;
+            case 'r': reconcile_ms = strtoul(optarg, NULL, 0) * 1000; break;
+            default: optind = argc + 1; break;
+        }
+    }
+    if( optind >= argc ) {
+        fprintf(stderr, "Usage: %s [-d] [-t topic] [-r reconcile_s] [name=]device...\n", argv[0]);
+        return 1;
+    }
+
+    epfd = epoll_create1(0);
+
+    for( int i = optind; i < argc; i++ ) {
+        const char *eq = strchr(argv[i], '=');
+        std::string name = eq ? std::string(argv[i], eq - argv[i]) : std::to_string(i - optind + 1);
+        Receiver *r = new Receiver(name, eq ? eq + 1 : argv[i]);
+        r->comm.on_recv(recvd, r);
+        r->comm.on_link(link_changed, r);
+        r->comm.reconcile(reconcile_ms);
+        receivers.push_back(r);
+        open_port(*r);
+    }
+
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    struct itimerspec tick = { { 0, TICK_NS }, { 0, TICK_NS } };
+    timerfd_settime(tfd, 0, &tick, NULL);
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &tfd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev);
+    ev.data.ptr = NULL;  // stdin, read without blocking the serial ports
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+    epoll_ctl(epfd, EPOLL_CTL_ADD, STDIN_FILENO, &ev);
+
+    while( true ) {
+        struct epoll_event events[16];
+        int n = epoll_wait(epfd, events, 16, -1);
+        if( n < 0 && errno != EINTR ) break;
+
+        for( int i = 0; i < n; i++ ) {
+            if( events[i].data.ptr == NULL ) {
+                if( !read_input(receivers) ) {
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);  // end of input, keep reporting
+                }
+            }
+            else if( events[i].data.ptr == &tfd ) {
+                uint64_t expirations;
+                if( ::read(tfd, &expirations, sizeof(expirations)) < 0 ) continue;
+                for( Receiver *r : receivers ) {
+                    if( r->failed_ms && millis() - r->failed_ms >= REOPEN_MS ) open_port(*r);
+                }
+            }
+            else {
+                Receiver &r = *(Receiver *)events[i].data.ptr;
+                if( !r.serial.fill() || (events[i].events & (EPOLLHUP | EPOLLERR)) ) {
+                    fprintf(stderr, "%s: %s failed\n", r.name.c_str(), r.device.c_str());
+                    close_port(r);
+                }
+            }
+        }
+
+        // every event and tick: let each receiver check responses, timeouts, pending volumes and batches
+        for( Receiver *r : receivers ) {
+            if( r->serial.fd() < 0 ) continue;
+            r->comm.handle();
+            r->volume.handle();
+            r->batch.handle();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Emulated Yamaha RX-V1600 AV Receiver on a Linux pseudo terminal
+// Connect a gateway or a terminal program to the printed device name
+// Usage: rxv1600emu [-l loss%] [-c corrupt%] [-s seed] [-L symlink]
+
+#include <rxv1600emu.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+
+int main( int argc, char *argv[] ) {
+    unsigned loss = 0;
+    unsigned corrupt = 0;
+    uint32_t seed = 1;
+    const char *link = NULL;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "l:c:s:L:")) != -1 ) {
+        switch( opt ) {
+            case 'l': loss = atoi(optarg); break;
+            case 'c': corrupt = atoi(optarg); break;
+            case 's': seed = strtoul(optarg, NULL, 0); break;
+            case 'L': link = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-l loss%%] [-c corrupt%%] [-s seed] [-L symlink]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int pty = posix_openpt(O_RDWR | O_NOCTTY);
+    if( pty < 0 || grantpt(pty) != 0 || unlockpt(pty) != 0 ) {
+        perror("pty");
+        return 1;
+    }
+
+    struct termios tio;
+    tcgetattr(pty, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(pty, TCSANOW, &tio);
+
+    const char *name = ptsname(pty);
+    if( link ) {
+        unlink(link);
+        if( symlink(name, link) != 0 ) {
+            perror(link);
+            return 1;
+        }
+        name = link;
+    }
+    printf("RX-V1600 emulator on %s\n", name);
+    fflush(stdout);
+
+    RxV1600Emu emu;
+    emu.errors(loss, corrupt, seed);
+
+    int pending = -1;  // byte taken from the emulator but not yet written
+
+    while( true ) {
+        // wake up early once a byte that did not fit can be written
+        struct pollfd pfd = { pty, (short)(pending < 0 ? POLLIN : POLLIN | POLLOUT), 0 };
+        if( poll(&pfd, 1, 1) > 0 && (pfd.revents & POLLIN) ) {
+            uint8_t buf[64];
+            ssize_t len = read(pty, buf, sizeof(buf));
+            for( ssize_t i = 0; i < len; i++ ) {
+                emu.write(buf[i]);
+            }
+        }
+
+        while( pending >= 0 || emu.available() ) {
+            if( pending < 0 ) pending = emu.read();
+            uint8_t ch = pending;
+            if( write(pty, &ch, 1) != 1 ) break;  // nobody connected yet or pty full: keep it for the next try
+            pending = -1;
+        }
+    }
+}
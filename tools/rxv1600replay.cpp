@@ -0,0 +1,290 @@
+// Replay a capture of RX-V1600 serial traffic, e.g. downloaded from /capture of a gateway
+// Received frames are fed through RxV1600Comm and RxV1600 at their recorded times on a
+// virtual clock, so decoding and timing problems of the field can be reproduced offline.
+// With -n the replay is repeated, e.g. to profile the decoding with perf.
+// Usage: rxv1600replay [-v] [-n repeat] capture.bin
+
+#include <rxv1600.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+
+static uint32_t clock_ms = 0;
+static uint32_t virtual_millis() { return clock_ms; }
+
+
+// One record of the capture, time relative to the first record
+typedef struct record {
+    RxV1600Capture::dir_t dir;
+    uint64_t us;
+    std::string frame;
+} record_t;
+
+
+// Stream with the received frames of the capture, readable from their recorded time on
+class ReplayStream : public Stream {
+    public:
+
+    void receive( uint32_t at_ms, const std::string &frame ) {
+        for( char ch : frame ) in.push_back({ at_ms, ch });
+    }
+
+    int available() override { return (!in.empty() && in.front().at_ms <= clock_ms) ? 1 : 0; }
+    int peek() override { return available() ? (uint8_t)in.front().ch : -1; }
+    int read() override {
+        if( !available() ) return -1;
+        int ch = (uint8_t)in.front().ch;
+        in.pop_front();
+        return ch;
+    }
+    size_t write(uint8_t) override { return 1; }  // commands are in the capture already
+
+    private:
+
+    typedef struct timed_char {
+        uint32_t at_ms;
+        char ch;
+    } timed_char_t;
+
+    std::deque<timed_char_t> in;
+};
+
+
+static bool verbose = false;
+
+
+static std::string printable( const std::string &frame ) {
+    static const char *names[] = { "NUL", "SOH", "STX", "ETX", "EOT", "ENQ", "ACK", "BEL" };
+    std::string str;
+    for( char ch : frame ) {
+        uint8_t byte = (uint8_t)ch;
+        if( byte < 8 ) str += std::string("<") + names[byte] + ">";
+        else if( byte >= 0x11 && byte <= 0x14 ) str += "<DC" + std::to_string(byte - 0x10) + ">";
+        else if( byte >= ' ' && byte < 0x7F ) str += ch;
+        else {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "<%02X>", byte);
+            str += hex;
+        }
+    }
+    return str;
+}
+
+
+static const char *command_name( const std::string &frame ) {
+    for( auto it = RxV1600::begin(); it != RxV1600::end(); it++ ) {
+        if( frame == it->second ) return it->first;
+    }
+    return NULL;
+}
+
+
+// Decode results of the replay
+typedef struct decoded {
+    unsigned reports;
+    unsigned configs;
+    unsigned texts;
+    unsigned unknown;
+    unsigned errors;
+} decoded_t;
+
+
+class Replay {
+    public:
+
+    Replay() : result(), comm(stream, virtual_millis), start(clock_ms), next(0) {
+        comm.on_recv(recvd, this);
+    }
+
+    void run( const std::vector<record_t> &records ) {
+        for( const record_t &r : records ) {
+            if( r.dir != RxV1600Capture::D_SENT ) stream.receive(start + (uint32_t)(r.us / 1000), r.frame);
+        }
+
+        uint32_t end = start + (uint32_t)(records.empty() ? 0 : records.back().us / 1000) + 1;
+        while( clock_ms != end ) {
+            if( verbose ) print_sent(records);
+            comm.handle();
+            clock_ms++;
+        }
+    }
+
+    decoded_t result;
+
+    private:
+
+    void print_sent( const std::vector<record_t> &records ) {
+        while( next < records.size() && start + records[next].us / 1000 <= clock_ms ) {
+            const record_t &r = records[next++];
+            if( r.dir == RxV1600Capture::D_SENT ) {
+                const char *name = command_name(r.frame);
+                printf("%10.3f > %s\n", r.us / 1000.0, name ? name : printable(r.frame).c_str());
+            }
+            else if( r.dir == RxV1600Capture::D_ERROR && r.frame.empty() ) {
+                printf("%10.3f ! timeout\n", r.us / 1000.0);
+            }
+        }
+    }
+
+    static void recvd( const char *resp, void *ctx ) {
+        Replay &r = *(Replay *)ctx;
+        bool power;
+        uint8_t id;
+        RxV1600::guard_t guard;
+        RxV1600::origin_t origin;
+        char text[9];
+        uint8_t changed[32];
+        double at = clock_ms - r.start;
+
+        if( !resp ) {
+            r.result.errors++;
+            if( verbose ) printf("%10.3f < garbage\n", at);
+        }
+        else if( r.rxv.decodeConfig(resp, power, changed) ) {
+            r.result.configs++;
+            if( verbose ) {
+                printf("%10.3f < config, power %s\n", at, power ? "on" : "off");
+                for( unsigned i = 0; i <= 0xFF; i++ ) {
+                    const char *name = RxV1600::report_name(i);
+                    if( name && (changed[i >> 3] & (1 << (i & 7))) ) {
+                        printf("%10s   %s %s\n", "", name, r.rxv.report_value_string(i));
+                    }
+                }
+            }
+        }
+        else if( r.rxv.decode(resp, id, guard, origin) ) {
+            r.result.reports++;
+            if( verbose ) {
+                const char *value = r.rxv.report_value_string(id);
+                printf("%10.3f < %s %s\n", at, RxV1600::report_name(id), value ? value : "?");
+            }
+        }
+        else if( r.rxv.decodeText(resp, id, text) ) {
+            r.result.texts++;
+            if( verbose ) printf("%10.3f < %s '%s'\n", at, RxV1600::display_name(id), text);
+        }
+        else {
+            r.result.unknown++;
+            if( verbose ) printf("%10.3f < unknown %s\n", at, printable(resp).c_str());
+        }
+    }
+
+    ReplayStream stream;
+    RxV1600Comm comm;
+    RxV1600 rxv;
+    uint32_t start;  // virtual time of the first record
+    size_t next;     // next record to list
+};
+
+
+static bool load( const char *path, std::vector<record_t> &records ) {
+    FILE *file = fopen(path, "rb");
+    if( !file ) return false;
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t len;
+    while( (len = fread(buf, 1, sizeof(buf), file)) > 0 ) data.insert(data.end(), buf, buf + len);
+    fclose(file);
+
+    size_t pos = 0;
+    RxV1600Capture::dir_t dir;
+    uint32_t us, prev_us = 0;
+    uint64_t elapsed = 0;
+    const char *frame;
+    while( RxV1600Capture::parse(data.data(), data.size(), pos, dir, us, frame, len) ) {
+        if( !records.empty() ) elapsed += us - prev_us;  // timestamps wrap after 71 minutes
+        prev_us = us;
+        records.push_back({ dir, elapsed, std::string(frame, len) });
+    }
+
+    if( pos != data.size() ) {
+        fprintf(stderr, "%s: invalid capture at offset %zu\n", path, pos);
+    }
+    return pos != 0;
+}
+
+
+// Statistics of the capture itself
+static void print_traffic( const std::vector<record_t> &records ) {
+    unsigned sent = 0, recvd = 0, garbage = 0, timeouts = 0, retries = 0;
+    std::vector<uint32_t> latencies;  // sent to next response
+    const record_t *last_sent = NULL;
+    bool answered = true;
+
+    for( const record_t &r : records ) {
+        if( r.dir == RxV1600Capture::D_SENT ) {
+            sent++;
+            if( last_sent && !answered && last_sent->frame == r.frame ) retries++;
+            last_sent = &r;
+            answered = false;
+        }
+        else {
+            if( r.dir == RxV1600Capture::D_RECV ) recvd++;
+            else if( r.frame.empty() ) timeouts++;
+            else garbage++;
+            if( last_sent && !answered && !r.frame.empty() ) latencies.push_back((uint32_t)(r.us - last_sent->us));
+            answered = true;
+        }
+    }
+
+    double secs = records.empty() ? 0 : records.back().us / 1e6;
+    printf("%zu records in %.3f s: %u sent (%u retries), %u received, %u garbage, %u timeouts\n",
+        records.size(), secs, sent, retries, recvd, garbage, timeouts);
+
+    if( !latencies.empty() ) {
+        std::sort(latencies.begin(), latencies.end());
+        size_t n = latencies.size();
+        printf("response latency: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f ms\n", latencies[n / 2] / 1000.0,
+            latencies[n * 9 / 10] / 1000.0, latencies[n * 99 / 100] / 1000.0, latencies[n - 1] / 1000.0);
+    }
+}
+
+
+int main( int argc, char *argv[] ) {
+    unsigned repeat = 1;
+
+    int opt;
+    while( (opt = getopt(argc, argv, "vn:")) != -1 ) {
+        switch( opt ) {
+            case 'v': verbose = true; break;
+            case 'n': repeat = strtoul(optarg, NULL, 0); break;
+            default: optind = argc; break;
+        }
+    }
+    if( optind != argc - 1 ) {
+        fprintf(stderr, "Usage: %s [-v] [-n repeat] capture.bin\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<record_t> records;
+    if( !load(argv[optind], records) ) {
+        fprintf(stderr, "%s: cannot load capture\n", argv[optind]);
+        return 1;
+    }
+    print_traffic(records);
+
+    decoded_t result = {};
+    auto start = std::chrono::steady_clock::now();
+    for( unsigned i = 0; i < repeat; i++ ) {
+        Replay *replay = new Replay();
+        replay->run(records);
+        result = replay->result;
+        delete replay;
+        verbose = false;  // list only the first pass
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("decoded: %u reports, %u configs, %u texts, %u unknown, %u errors\n",
+        result.reports, result.configs, result.texts, result.unknown, result.errors);
+    printf("replayed %u times in %.1f ms\n", repeat, ms);
+
+    return 0;
+}